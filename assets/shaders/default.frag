@@ -3,15 +3,23 @@
 uniform sampler2D baseColorTexture;
 uniform sampler2D metallicRoughnessTexture;
 
-uniform int hasBaseColorTexture;
-uniform int hasMetallicRoughnessTexture;
-
+// std430, mirrors GpuMaterial in material.hpp
 struct Material {
     vec4 base_color;
     float metalness;
     float roughness;
+    float alpha_cutoff;
+    uint flags;
 };
-uniform Material mat;
+const uint MATERIAL_DOUBLE_SIDED = 1u;
+const uint MATERIAL_HAS_BASE_COLOR_TEXTURE = 2u;
+const uint MATERIAL_HAS_METALLIC_ROUGHNESS_TEXTURE = 4u;
+const uint MATERIAL_ALPHA_MASK = 8u;
+const uint MATERIAL_ALPHA_BLEND = 16u;
+layout(std430, binding = 1) readonly buffer Materials {
+    Material materials[];
+};
+uniform uint u_Material;
 
 uniform vec3 u_CameraPosition;
 
@@ -63,14 +71,18 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 }
 
 void main() {
+    const Material mat = materials[u_Material];
     vec4 albedo = mat.base_color;
-    if (hasBaseColorTexture == 1) {
+    if ((mat.flags & MATERIAL_HAS_BASE_COLOR_TEXTURE) != 0u) {
         albedo = texture(baseColorTexture, texCoord_);
     }
+    if ((mat.flags & MATERIAL_ALPHA_MASK) != 0u && albedo.a < mat.alpha_cutoff) {
+        discard;
+    }
 
     float metallic = mat.metalness;
     float roughness = mat.roughness;
-    if (hasMetallicRoughnessTexture == 1) {
+    if ((mat.flags & MATERIAL_HAS_METALLIC_ROUGHNESS_TEXTURE) != 0u) {
         vec4 t = texture(metallicRoughnessTexture, texCoord_);
         roughness *= t.g;
         metallic *= t.b;
@@ -4,17 +4,21 @@ layout(location=0) in vec3 aPos;
 layout(location=1) in vec3 aNormal;
 layout(location=2) in vec2 aTexCoord;
 
+layout(std430, binding = 2) readonly buffer Instances {
+    mat4 instance_matrices[];
+};
+
 uniform mat4 u_PV;
-uniform mat4 u_ModelMatrix;
 
 out vec3 worldSpacePos_;
 out vec3 normal_;
 out vec2 texCoord_;
 
 void main() {
-    const vec4 worldSpacePos = u_ModelMatrix * vec4(aPos, 1.0f);
+    const mat4 model_matrix = instance_matrices[gl_BaseInstance + gl_InstanceID];
+    const vec4 worldSpacePos = model_matrix * vec4(aPos, 1.0f);
     gl_Position = u_PV * worldSpacePos;
     worldSpacePos_ = vec3(worldSpacePos);
-    normal_ = normalize(transpose(inverse(mat3(u_ModelMatrix))) * aNormal);
+    normal_ = normalize(transpose(inverse(mat3(model_matrix))) * aNormal);
     texCoord_ = aTexCoord;
 }
@@ -0,0 +1,36 @@
+#version 460 core
+
+layout(location=0) in vec3 aPos;
+layout(location=1) in vec3 aNormal;
+layout(location=2) in vec2 aTexCoord;
+
+struct Draw {
+    uint material;
+};
+layout(std430, binding = 0) readonly buffer Draws {
+    Draw draws[];
+};
+// every command draws its visible instances, base_instance points at the first one's matrix
+layout(std430, binding = 2) readonly buffer Instances {
+    mat4 instance_matrices[];
+};
+
+uniform mat4 u_PV;
+// gl_DrawID restarts at 0 for every glMultiDrawElementsIndirect call
+uniform uint u_DrawOffset;
+
+out vec3 worldSpacePos_;
+out vec3 normal_;
+out vec2 texCoord_;
+flat out uint material_;
+
+void main() {
+    const Draw d = draws[u_DrawOffset + gl_DrawID];
+    const mat4 model_matrix = instance_matrices[gl_BaseInstance + gl_InstanceID];
+    const vec4 worldSpacePos = model_matrix * vec4(aPos, 1.0f);
+    gl_Position = u_PV * worldSpacePos;
+    worldSpacePos_ = vec3(worldSpacePos);
+    normal_ = normalize(transpose(inverse(mat3(model_matrix))) * aNormal);
+    texCoord_ = aTexCoord;
+    material_ = d.material;
+}
@@ -0,0 +1,429 @@
+// Headless load-time benchmark. Generates a synthetic .glb (or takes an existing one),
+// times the loader stages separately and prints the results as JSON.
+//
+//   make bench_load && ./bench_load.out --meshes 256 --vertices 20000 --textures 16 --runs 5
+
+#include "synthetic_glb.hpp"
+#include "overdraw.hpp"
+#include "stub_gl.hpp"
+
+#include "asset_manager.hpp"
+#include "job_system.hpp"
+#include "mesh_optimizer.hpp"
+#include "json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unistd.h>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+    bench::SyntheticConfig synthetic{};
+    std::filesystem::path input{};  // benchmark this file instead of a synthetic one
+    std::filesystem::path output{}; // JSON goes to stdout if empty
+    uint32_t runs{5};
+    bool upload{false};
+    bool optimize{false};
+    bool overdraw{false};
+    bool weld{false};
+    uint32_t lods{0};
+    bool keep{false};
+};
+
+static void print_usage()
+{
+    printf(
+        "usage: bench_load.out [options]\n"
+        "  --meshes N         meshes in the synthetic model (64)\n"
+        "  --vertices N       vertices per mesh (10000)\n"
+        "  --textures N       textures, one material each (8)\n"
+        "  --texture-size N   texture width/height in pixels (1024)\n"
+        "  --stride N         interleaved vertex stride, 0 for separate attributes (0)\n"
+        "  --index-bits N     8, 16 or 32 (32)\n"
+        "  --gpu-instances N  EXT_mesh_gpu_instancing instances per mesh, 0 for plain nodes (0)\n"
+        "  --shuffle          write each mesh's triangles in random order\n"
+        "  --torus            wrap each mesh into a torus instead of a height field\n"
+        "  --unindexed        write triangle soups without indices\n"
+        "  --input FILE       benchmark an existing .glb instead\n"
+        "  --runs N           repetitions per stage (5)\n"
+        "  --upload           also time uploads and full load_glb() (with its LoadStats) against a stub GL\n"
+        "  --weld             also time welding duplicate vertices and report the reduction\n"
+        "  --lods N           also time generating N levels of detail and report their triangles (0)\n"
+        "  --optimize         also time the mesh optimization (cache, overdraw, fetch) and report ACMR/ATVR\n"
+        "  --overdraw         count shaded fragments from 14 fixed views, before and after --optimize\n"
+        "  --keep             keep the generated .glb\n"
+        "  --out FILE         write the JSON report to FILE\n");
+}
+
+static bool parse_args(int argc, char** argv, BenchOptions& opts)
+{
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const auto next = [&](uint32_t& value) {
+            if (i + 1 >= argc)
+                return false;
+            value = static_cast<uint32_t>(std::stoul(argv[++i]));
+            return true;
+        };
+
+        bool ok = true;
+        if (arg == "--meshes") ok = next(opts.synthetic.meshes);
+        else if (arg == "--vertices") ok = next(opts.synthetic.vertices_per_mesh);
+        else if (arg == "--textures") ok = next(opts.synthetic.textures);
+        else if (arg == "--texture-size") ok = next(opts.synthetic.texture_size);
+        else if (arg == "--stride") ok = next(opts.synthetic.stride);
+        else if (arg == "--index-bits") ok = next(opts.synthetic.index_bits);
+        else if (arg == "--gpu-instances") ok = next(opts.synthetic.gpu_instances);
+        else if (arg == "--runs") ok = next(opts.runs);
+        else if (arg == "--upload") opts.upload = true;
+        else if (arg == "--optimize") opts.optimize = true;
+        else if (arg == "--shuffle") opts.synthetic.shuffle_triangles = true;
+        else if (arg == "--torus") opts.synthetic.torus = true;
+        else if (arg == "--overdraw") opts.overdraw = true;
+        else if (arg == "--unindexed") opts.synthetic.unindexed = true;
+        else if (arg == "--weld") opts.weld = true;
+        else if (arg == "--lods") ok = next(opts.lods);
+        else if (arg == "--keep") opts.keep = true;
+        else if (arg == "--input" && i + 1 < argc) opts.input = argv[++i];
+        else if (arg == "--out" && i + 1 < argc) opts.output = argv[++i];
+        else ok = false;
+
+        if (!ok) {
+            print_usage();
+            return false;
+        }
+    }
+    opts.runs = std::max(opts.runs, 1u);
+    return true;
+}
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static json summarize(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double s : samples)
+        sum += s;
+    return {
+        {"min_ms", samples.front()},
+        {"median_ms", samples[samples.size() / 2]},
+        {"mean_ms", sum / samples.size()},
+        {"max_ms", samples.back()},
+    };
+}
+
+// One pass over the individual stages, the same work load_glb() does but timed step by step.
+static bool run_stages(const std::filesystem::path& path, const BenchOptions& opts, std::map<std::string, double>& times,
+                       json& counts)
+{
+    using namespace AssetManager;
+
+    auto start = Clock::now();
+    tinygltf::Model model;
+    std::string err, warn;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(capture_image_bytes, nullptr);
+    if (!loader.LoadBinaryFromFile(&model, &err, &warn, path.string())) {
+        printf("Failed to parse '%s': %s\n", path.c_str(), err.c_str());
+        return false;
+    }
+    BufferSpans buffers{};
+    for (const auto& buffer : model.buffers)
+        buffers.emplace_back(buffer.data);
+    times["parse"] = ms_since(start);
+
+    start = Clock::now();
+    // one entry per glTF primitive, the way the loader splits them
+    std::vector<const tinygltf::Primitive*> primitives{};
+    for (const auto& mesh : model.meshes) {
+        for (const auto& primitive : mesh.primitives)
+            primitives.push_back(&primitive);
+    }
+    std::vector<MeshData> meshes(primitives.size());
+    std::atomic<bool> decoded{true};
+    job_system().parallel_for(primitives.size(), [&](size_t i) {
+        if (!decode_glb_primitive(model, buffers, *primitives[i], meshes[i]))
+            decoded = false;
+    });
+    times["mesh_decode"] = ms_since(start);
+    if (!decoded) {
+        printf("Failed to decode meshes.\n");
+        return false;
+    }
+
+    WeldStats weld{};
+    if (opts.weld) {
+        start = Clock::now();
+        std::vector<WeldStats> mesh_stats(meshes.size());
+        job_system().parallel_for(meshes.size(), [&](size_t i) { mesh_optimizer::weld_vertices(meshes[i], mesh_stats[i]); });
+        times["mesh_weld"] = ms_since(start);
+        for (const auto& s : mesh_stats)
+            weld += s;
+    }
+
+    LodStats lods{};
+    if (opts.lods > 0) {
+        start = Clock::now();
+        std::vector<LodStats> mesh_stats(meshes.size());
+        job_system().parallel_for(meshes.size(), [&](size_t i) {
+            mesh_optimizer::generate_lods(meshes[i], mesh_stats[i], opts.lods, LoadOptions{}.lod_ratio);
+        });
+        times["mesh_lods"] = ms_since(start);
+        for (const auto& s : mesh_stats)
+            lods += s;
+    }
+
+    // untimed, the rasterizer is far slower than the loader
+    const auto measure_overdraw = [&]() {
+        std::vector<bench::OverdrawStats> mesh_stats(meshes.size());
+        job_system().parallel_for(meshes.size(), [&](size_t i) { mesh_stats[i] = bench::measure_overdraw(meshes[i]); });
+        bench::OverdrawStats total{};
+        for (const auto& s : mesh_stats)
+            total += s;
+        return total;
+    };
+    bench::OverdrawStats overdraw{}, overdraw_optimized{};
+    if (opts.overdraw)
+        overdraw = measure_overdraw();
+
+    VertexCacheStats vertex_cache{};
+    if (opts.optimize) {
+        start = Clock::now();
+        std::vector<VertexCacheStats> mesh_stats(meshes.size());
+        job_system().parallel_for(meshes.size(), [&](size_t i) {
+            mesh_optimizer::optimize(meshes[i], mesh_stats[i]);
+        });
+        times["mesh_optimize"] = ms_since(start);
+        for (const auto& s : mesh_stats)
+            vertex_cache += s;
+        if (opts.overdraw)
+            overdraw_optimized = measure_overdraw();
+    }
+
+    start = Clock::now();
+    std::vector<DecodedImage> images{};
+    {
+        ImageBatch batch{};
+        start_image_decode(model, buffers, batch);
+        for (; batch.nof_jobs > 0; batch.nof_jobs--)
+            images.push_back(batch.finished.pop());
+    }
+    times["image_decode"] = ms_since(start);
+
+    start = Clock::now();
+    Model instanced{};
+    instanced.meshes.resize(meshes.size());
+    if (!load_glb_transformations(instanced, model, buffers)) {
+        printf("Failed to load transformations.\n");
+        return false;
+    }
+    update_transforms(instanced);
+    times["transforms"] = ms_since(start);
+
+    uint64_t nof_vertices = 0, nof_indices = 0, compressed_image_bytes = 0;
+    for (const auto& m : meshes) {
+        nof_vertices += m.positions.size();
+        nof_indices += m.indices.size();
+    }
+    for (const auto& d : images)
+        compressed_image_bytes += d.compressed_size;
+    counts = {
+        {"meshes", model.meshes.size()},
+        {"primitives", meshes.size()},
+        {"instances", instanced.instances.size()},
+        {"vertices", nof_vertices},
+        {"indices", nof_indices},
+        {"images", images.size()},
+        {"compressed_image_bytes", compressed_image_bytes},
+    };
+    if (opts.weld) {
+        counts["vertices_before_weld"] = weld.vertices_before;
+        counts["weld_reduction"] = weld.reduction();
+    }
+    if (opts.lods > 0) {
+        // triangles if every mesh was drawn at level l, or its coarsest one if it has fewer
+        const auto triangles_at = [](const MeshData& m, uint32_t level) -> uint64_t {
+            if (level == 0 || m.lods.empty())
+                return m.base_count() / 3;
+            return m.lods[std::min<size_t>(level, m.lods.size()) - 1].count / 3;
+        };
+        json per_level = json::array();
+        for (uint32_t l = 0; l <= opts.lods; l++) {
+            uint64_t triangles = 0;
+            for (const auto& m : meshes)
+                triangles += triangles_at(m, l);
+            per_level.push_back(triangles);
+        }
+        counts["lod_triangles"] = per_level;
+        counts["lod_levels"] = lods.levels;
+        counts["lod_reduction"] = lods.reduction();
+    }
+    if (opts.optimize) {
+        counts["acmr_before"] = vertex_cache.acmr_before();
+        counts["acmr_after"] = vertex_cache.acmr_after();
+        counts["atvr_before"] = vertex_cache.atvr_before();
+        counts["atvr_after"] = vertex_cache.atvr_after();
+    }
+    if (opts.overdraw) {
+        counts["covered_pixels"] = overdraw.covered;
+        counts["shaded_fragments"] = overdraw.shaded;
+        counts["overdraw"] = overdraw.overdraw();
+        if (opts.optimize) {
+            counts["shaded_fragments_optimized"] = overdraw_optimized.shaded;
+            counts["overdraw_optimized"] = overdraw_optimized.overdraw();
+        }
+    }
+
+    if (opts.upload) {
+        bench::reset_stub_gl_stats();
+        start = Clock::now();
+        std::vector<Model::Primitive> uploaded(meshes.size());
+        uint64_t first_vertex = 0, index_bytes = 0;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            uploaded[i].base_vertex = static_cast<int32_t>(first_vertex);
+            place_indices(uploaded[i], meshes[i].positions.size(), meshes[i].indices.size(), index_bytes);
+            first_vertex += meshes[i].positions.size();
+        }
+        Model::Geometry geometry{};
+        create_geometry(geometry, nof_vertices, index_bytes);
+        for (size_t i = 0; i < meshes.size(); i++)
+            upload_mesh(geometry, uploaded[i], meshes[i].spans());
+        counts["index_bytes"] = index_bytes;
+        for (const auto& d : images) {
+            if (!d.ok)
+                continue;
+            Texture::TextureConfig tc{};
+            tc.internalformat = static_cast<uint32_t>(d.image.component);
+            tc.format = static_cast<uint32_t>(d.image.bits);
+            tc.type = static_cast<uint32_t>(d.image.pixel_type);
+            tc.width = static_cast<uint32_t>(d.image.width);
+            tc.height = static_cast<uint32_t>(d.image.height);
+            Texture t{};
+            t.create_texture(tc, d.image.image.data());
+        }
+        times["upload"] = ms_since(start);
+        const auto stats = bench::stub_gl_stats();
+        counts["uploaded_buffer_bytes"] = stats.buffer_bytes;
+        counts["uploaded_texture_bytes"] = stats.texture_bytes;
+    }
+
+    return true;
+}
+
+// Full AssetManager::load_glb() with the given options, unloaded again afterwards.
+// Its own per-stage LoadStats are recorded as "<label>/<stage>", its peak heap usage (counted
+// through counted_new.cpp) as the count "<label>_peak_alloc_bytes".
+static bool run_load_glb(const std::filesystem::path& path, AssetManager::LoadOptions options, const std::string& label,
+                         std::map<std::string, std::vector<double>>& samples, json& counts)
+{
+    LoadStats stats{};
+    options.stats = &stats;
+    const auto start = Clock::now();
+    const auto handle = AssetManager::load_glb(std::filesystem::absolute(path).string(), options);
+    samples[label].push_back(ms_since(start));
+    if (!handle)
+        return false;
+
+    for (size_t i = 0; i < NOF_LOAD_STAGES; i++)
+        samples[label + "/" + to_string(static_cast<LoadStage>(i))].push_back(stats.stages[i].ms);
+    counts[label + "_peak_alloc_bytes"] = stats.peak_alloc_bytes;
+
+    AssetManager::unload_model(handle);
+    AssetManager::materials.clear();
+    AssetManager::textures.clear();
+    AssetManager::clear_texture_cache();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions opts{};
+    if (!parse_args(argc, argv, opts))
+        return EXIT_FAILURE;
+
+    // stdout carries the report, keep loader chatter on stderr
+    const int report_fd = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    bench::install_stub_gl();
+
+    std::filesystem::path path = opts.input;
+    const bool synthetic = path.empty();
+    if (synthetic) {
+        path = std::filesystem::temp_directory_path() / ("bench_load_" + std::to_string(getpid()) + ".glb");
+        const auto start = Clock::now();
+        if (!bench::write_synthetic_glb(path, opts.synthetic)) {
+            printf("Failed to generate synthetic model.\n");
+            return EXIT_FAILURE;
+        }
+        printf("Generated '%s' in %.1f ms.\n", path.c_str(), ms_since(start));
+    }
+
+    std::map<std::string, std::vector<double>> samples{};
+    json counts{};
+    bool ok = true;
+    for (uint32_t r = 0; r < opts.runs && ok; r++) {
+        std::map<std::string, double> times{};
+        ok = run_stages(path, opts, times, counts);
+        for (const auto& [stage, ms] : times)
+            samples[stage].push_back(ms);
+
+        if (ok && opts.upload) {
+            const AssetManager::LoadOptions sequential{};
+            const AssetManager::LoadOptions parallel{.memory_map = true, .parallel_images = true};
+            ok = run_load_glb(path, sequential, "load_glb", samples, counts) &&
+                 run_load_glb(path, parallel, "load_glb_mmap_parallel_images", samples, counts);
+        }
+    }
+
+    json report = {
+        {"file", path.string()},
+        {"file_size", std::filesystem::file_size(path)},
+        {"runs", opts.runs},
+        {"workers", job_system().size()},
+        {"counts", counts},
+    };
+    if (synthetic) {
+        const auto& c = opts.synthetic;
+        report["synthetic"] = {
+            {"meshes", c.meshes},
+            {"vertices_per_mesh", c.vertices_per_mesh},
+            {"textures", c.textures},
+            {"texture_size", c.texture_size},
+            {"stride", c.stride},
+            {"index_bits", c.index_bits},
+            {"unindexed", c.unindexed},
+        };
+    }
+    for (const auto& [stage, values] : samples)
+        report["stages"][stage] = summarize(values);
+
+    if (synthetic && !opts.keep)
+        std::filesystem::remove(path);
+
+    if (!ok) {
+        printf("Benchmark failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    const std::string text = report.dump(2) + "\n";
+    if (!opts.output.empty()) {
+        std::ofstream out(opts.output);
+        out << text;
+    } else {
+        write(report_fd, text.data(), text.size());
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+#include "load_stats.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+// Replacements for the global allocation functions so LoadStats::peak_alloc_bytes includes C++
+// allocations. Only linked into bench_load, see alloc_stats.
+
+static void* counted_new(size_t size)
+{
+    if (void* ptr = alloc_stats::counted_malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+static void* counted_new_aligned(size_t size, std::align_val_t align)
+{
+    const size_t a = static_cast<size_t>(align);
+    if (void* ptr = alloc_stats::counted_aligned_alloc(a, (std::max<size_t>(size, 1) + a - 1) / a * a))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return alloc_stats::counted_malloc(size == 0 ? 1 : size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return alloc_stats::counted_malloc(size == 0 ? 1 : size); }
+void* operator new(size_t size, std::align_val_t align) { return counted_new_aligned(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return counted_new_aligned(size, align); }
+
+void operator delete(void* ptr) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { alloc_stats::counted_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { alloc_stats::counted_free(ptr); }
@@ -0,0 +1,100 @@
+#include "overdraw.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace bench {
+
+    OverdrawStats& OverdrawStats::operator+=(const OverdrawStats& other)
+    {
+        covered += other.covered;
+        shaded += other.shaded;
+        return *this;
+    }
+
+    OverdrawStats measure_overdraw(const AssetManager::MeshData& mesh, uint32_t resolution)
+    {
+        OverdrawStats stats{};
+        const size_t nof_vertices = mesh.positions.size();
+        if (nof_vertices == 0 || resolution == 0)
+            return stats;
+
+        glm::vec3 lo = mesh.positions[0], hi = mesh.positions[0];
+        for (const auto& p : mesh.positions) {
+            lo = glm::min(lo, p);
+            hi = glm::max(hi, p);
+        }
+        const glm::vec3 center = 0.5f * (lo + hi);
+        const float radius = std::max(0.5f * glm::length(hi - lo), 1e-6f);
+
+        std::vector<glm::vec3> views{};
+        for (int axis = 0; axis < 3; axis++) {
+            for (const float sign : {1.0f, -1.0f}) {
+                glm::vec3 d{0.0f};
+                d[axis] = sign;
+                views.push_back(d);
+            }
+        }
+        for (int corner = 0; corner < 8; corner++)
+            views.push_back(glm::normalize(glm::vec3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f)));
+
+        const float res = static_cast<float>(resolution);
+        std::vector<glm::vec3> screen(nof_vertices);
+        std::vector<float> depth(size_t{resolution} * resolution);
+        for (const glm::vec3& backward : views) {
+            // camera looks down -backward, so counter-clockwise on screen is a front face
+            const glm::vec3 hint = std::abs(backward.y) > 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            const glm::vec3 right = glm::normalize(glm::cross(hint, backward));
+            const glm::vec3 up = glm::cross(backward, right);
+            for (size_t v = 0; v < nof_vertices; v++) {
+                const glm::vec3 q = mesh.positions[v] - center;
+                screen[v] = glm::vec3((glm::dot(q, right) / radius * 0.5f + 0.5f) * res,
+                                      (glm::dot(q, up) / radius * 0.5f + 0.5f) * res,
+                                      -glm::dot(q, backward));
+            }
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+
+            for (size_t t = 0; t + 2 < mesh.base_count(); t += 3) {
+                const glm::vec3& a = screen[mesh.indices[t + 0]];
+                const glm::vec3& b = screen[mesh.indices[t + 1]];
+                const glm::vec3& c = screen[mesh.indices[t + 2]];
+                const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+                if (area <= 0.0f)
+                    continue;
+
+                const int x0 = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+                const int x1 = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+                const int y0 = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+                const int y1 = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+                // pixels on a shared edge belong to one side only: the edge's left or bottom one
+                const auto edge = [](const glm::vec3& p, const glm::vec3& q, float x, float y) {
+                    const float e = (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x);
+                    if (e != 0.0f)
+                        return e > 0.0f;
+                    return q.y < p.y || (q.y == p.y && q.x > p.x);
+                };
+                for (int y = y0; y <= y1; y++) {
+                    const float py = static_cast<float>(y) + 0.5f;
+                    for (int x = x0; x <= x1; x++) {
+                        const float px = static_cast<float>(x) + 0.5f;
+                        if (!edge(a, b, px, py) || !edge(b, c, px, py) || !edge(c, a, px, py))
+                            continue;
+                        const float wa = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) / area;
+                        const float wb = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) / area;
+                        const float z = wa * a.z + wb * b.z + (1.0f - wa - wb) * c.z;
+                        float& stored = depth[size_t{static_cast<uint32_t>(y)} * resolution + static_cast<uint32_t>(x)];
+                        if (z < stored) {
+                            stored = z;
+                            stats.shaded++;
+                        }
+                    }
+                }
+            }
+            stats.covered += static_cast<uint64_t>(std::count_if(depth.begin(), depth.end(), [](float z) { return std::isfinite(z); }));
+        }
+        return stats;
+    }
+
+}; // end namespace 'bench'
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "asset_manager.hpp"
+
+#include <cstdint>
+
+namespace bench {
+
+    struct OverdrawStats {
+        // pixels covered by at least one front face, summed over the views
+        uint64_t covered{0};
+        // fragments that passed the depth test when they were drawn, i.e. were shaded without a prepass
+        uint64_t shaded{0};
+
+        [[nodiscard]] double overdraw() const { return covered > 0 ? static_cast<double>(shaded) / covered : 0.0; }
+        OverdrawStats& operator+=(const OverdrawStats& other);
+    };
+
+    // Rasterizes the mesh's full detail front faces (counter-clockwise, as glTF) in index order with a depth
+    // test from a fixed set of 14 orthographic views around its bounds: along the 3 axes both
+    // ways and the 8 cube diagonals. Each view is 'resolution' pixels square.
+    OverdrawStats measure_overdraw(const AssetManager::MeshData& mesh, uint32_t resolution = 256);
+
+}; // end namespace 'bench'
@@ -0,0 +1,108 @@
+#include "stub_gl.hpp"
+
+#include "glad.h"
+
+#include <cstring>
+#include <vector>
+
+namespace bench {
+
+    static GLuint next_name = 1;
+    static StubGlStats stats{};
+    static std::vector<unsigned char> scratch{};
+
+    static void copy_to_scratch(const void* data, size_t size)
+    {
+        if (data == nullptr || size == 0)
+            return;
+        if (scratch.size() < size)
+            scratch.resize(size);
+        std::memcpy(scratch.data(), data, size);
+    }
+
+    static size_t pixel_size(GLenum format, GLenum type)
+    {
+        size_t channels = 4;
+        switch (format) {
+            case GL_RED: channels = 1; break;
+            case GL_RG: channels = 2; break;
+            case GL_RGB: channels = 3; break;
+            default: break;
+        }
+        switch (type) {
+            case GL_UNSIGNED_SHORT: return channels * 2;
+            case GL_FLOAT: return channels * 4;
+            default: return channels;
+        }
+    }
+
+    static void APIENTRY gen_names(GLsizei n, GLuint* names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+            names[i] = next_name++;
+    }
+
+    static void APIENTRY buffer_data(GLenum, GLsizeiptr size, const void* data, GLenum)
+    {
+        // allocations without data are filled by buffer_sub_data later
+        if (data == nullptr)
+            return;
+        copy_to_scratch(data, static_cast<size_t>(size));
+        stats.buffer_bytes += static_cast<uint64_t>(size);
+    }
+
+    static void APIENTRY buffer_sub_data(GLenum, GLintptr, GLsizeiptr size, const void* data)
+    {
+        copy_to_scratch(data, static_cast<size_t>(size));
+        stats.buffer_bytes += static_cast<uint64_t>(size);
+    }
+
+    static void APIENTRY tex_image_2d(GLenum, GLint, GLint internalformat, GLsizei width, GLsizei height,
+                                      GLint, GLenum format, GLenum type, const void* pixels)
+    {
+        // the loaders pass the base format in either slot, take whichever is one
+        const bool internal_is_base = internalformat == GL_RED || internalformat == GL_RG ||
+                                      internalformat == GL_RGB || internalformat == GL_RGBA;
+        const size_t size = size_t(width) * height * pixel_size(internal_is_base ? internalformat : format, type);
+        copy_to_scratch(pixels, size);
+        stats.texture_bytes += size;
+    }
+
+    template <typename... Args>
+    static void stub_noop(void (*&fn)(Args...))
+    {
+        fn = [](Args...) {};
+    }
+
+    void install_stub_gl()
+    {
+        glad_glGenBuffers = gen_names;
+        glad_glGenTextures = gen_names;
+        glad_glGenVertexArrays = gen_names;
+        glad_glBufferData = buffer_data;
+        glad_glBufferSubData = buffer_sub_data;
+        glad_glTexImage2D = tex_image_2d;
+
+        stub_noop(glad_glDeleteBuffers);
+        stub_noop(glad_glDeleteTextures);
+        stub_noop(glad_glDeleteVertexArrays);
+        stub_noop(glad_glBindBuffer);
+        stub_noop(glad_glBindTexture);
+        stub_noop(glad_glBindVertexArray);
+        stub_noop(glad_glEnableVertexAttribArray);
+        stub_noop(glad_glVertexAttribPointer);
+        stub_noop(glad_glTexParameteri);
+        stub_noop(glad_glGenerateMipmap);
+    }
+
+    StubGlStats stub_gl_stats()
+    {
+        return stats;
+    }
+
+    void reset_stub_gl_stats()
+    {
+        stats = StubGlStats{};
+    }
+
+}; // end namespace 'bench'
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bench {
+
+    // Bytes handed to the stub driver since the last reset.
+    struct StubGlStats {
+        uint64_t buffer_bytes{0};
+        uint64_t texture_bytes{0};
+    };
+
+    // Points the glad entry points used by the loaders at CPU-only stand-ins, so uploads can be
+    // timed without a context. Object names are handed out sequentially and buffer/texture data
+    // is copied once into scratch memory, roughly what a driver does with a staging copy.
+    // Anything not stubbed stays null; extend the list when the loaders start using new calls.
+    void install_stub_gl();
+
+    StubGlStats stub_gl_stats();
+    void reset_stub_gl_stats();
+
+}; // end namespace 'bench'
@@ -0,0 +1,333 @@
+#include "synthetic_glb.hpp"
+
+#include "json.hpp"
+#include "stb_image_write.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    using json = nlohmann::json;
+
+    constexpr int GL_ARRAY_BUFFER = 34962;
+    constexpr int GL_ELEMENT_ARRAY_BUFFER = 34963;
+    constexpr int GL_FLOAT = 5126;
+    constexpr int GL_UNSIGNED_BYTE = 5121;
+    constexpr int GL_UNSIGNED_SHORT = 5123;
+    constexpr int GL_UNSIGNED_INT = 5125;
+
+    // Appends to the BIN chunk and records bufferViews.
+    struct BinWriter {
+        std::vector<unsigned char> bin{};
+        json views = json::array();
+
+        int add_view(const void* data, size_t size, int target, uint32_t stride = 0)
+        {
+            while (bin.size() % 4 != 0)
+                bin.push_back(0);
+            json view = {{"buffer", 0}, {"byteOffset", bin.size()}, {"byteLength", size}};
+            if (target != 0)
+                view["target"] = target;
+            if (stride != 0)
+                view["byteStride"] = stride;
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            bin.insert(bin.end(), bytes, bytes + size);
+            views.push_back(view);
+            return static_cast<int>(views.size() - 1);
+        }
+    };
+
+    // torus radii, the ring fills the same unit square as the flat grid
+    constexpr float TORUS_RING = 0.35f, TORUS_TUBE = 0.15f;
+
+    static uint32_t xorshift(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    static std::vector<unsigned char> make_png(uint32_t size, uint32_t seed)
+    {
+        // gradient plus a little noise: compresses roughly like a real albedo map
+        std::vector<unsigned char> pixels(size_t{size} * size * 4);
+        uint32_t state = seed * 2654435761u + 1;
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                unsigned char* p = &pixels[(size_t{y} * size + x) * 4];
+                const uint32_t noise = xorshift(state) & 0x1f;
+                p[0] = static_cast<unsigned char>((x * 255 / size + noise + seed * 37) & 0xff);
+                p[1] = static_cast<unsigned char>((y * 255 / size + noise) & 0xff);
+                p[2] = static_cast<unsigned char>(((x ^ y) + seed * 11) & 0xff);
+                p[3] = 255;
+            }
+        }
+
+        std::vector<unsigned char> png{};
+        stbi_write_png_to_func([](void* ctx, void* data, int n) {
+            auto* out = static_cast<std::vector<unsigned char>*>(ctx);
+            const auto* bytes = static_cast<const unsigned char*>(data);
+            out->insert(out->end(), bytes, bytes + n);
+        }, &png, size, size, 4, pixels.data(), size * 4);
+        return png;
+    }
+
+    template <typename T>
+    static void append_grid_indices(uint32_t w, uint32_t h, std::vector<unsigned char>& out)
+    {
+        const auto push = [&](uint32_t i) {
+            const T v = static_cast<T>(i);
+            const auto* bytes = reinterpret_cast<const unsigned char*>(&v);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        };
+        for (uint32_t y = 0; y + 1 < h; y++) {
+            for (uint32_t x = 0; x + 1 < w; x++) {
+                const uint32_t i = y * w + x;
+                push(i); push(i + w); push(i + 1);
+                push(i + 1); push(i + w); push(i + w + 1);
+            }
+        }
+    }
+
+    bool write_synthetic_glb(const std::filesystem::path& path, const SyntheticConfig& config)
+    {
+        const uint32_t w = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(config.vertices_per_mesh))));
+        const uint32_t h = std::max(2u, config.vertices_per_mesh / w);
+        uint64_t nof_vertices = uint64_t{w} * h;
+
+        int index_type = 0;
+        size_t index_size = 0;
+        switch (config.index_bits) {
+            case 8: index_type = GL_UNSIGNED_BYTE; index_size = 1; break;
+            case 16: index_type = GL_UNSIGNED_SHORT; index_size = 2; break;
+            case 32: index_type = GL_UNSIGNED_INT; index_size = 4; break;
+            default:
+                printf("Unsupported index size %u.\n", config.index_bits);
+                return false;
+        }
+        if (!config.unindexed && index_size < 4 && nof_vertices > (uint64_t{1} << (8 * index_size))) {
+            printf("%llu vertices per mesh do not fit %u-bit indices.\n",
+                static_cast<unsigned long long>(nof_vertices), config.index_bits);
+            return false;
+        }
+        if (config.stride != 0 && (config.stride < 32 || config.stride % 4 != 0)) {
+            printf("Interleaved stride must be a multiple of 4 and at least 32.\n");
+            return false;
+        }
+
+        BinWriter bin{};
+        json accessors = json::array();
+        json meshes = json::array();
+        json nodes = json::array();
+        json scene_nodes = json::array();
+
+        const auto add_accessor = [&](int view, size_t offset, int component_type, size_t count, const char* type) {
+            accessors.push_back({{"bufferView", view}, {"byteOffset", offset},
+                                 {"componentType", component_type}, {"count", count}, {"type", type}});
+            return static_cast<int>(accessors.size() - 1);
+        };
+
+        // same grid for every mesh, so the BIN size scales linearly with the mesh count
+        std::vector<float> pos(nof_vertices * 3), norm(nof_vertices * 3), tc(nof_vertices * 2);
+        for (uint32_t y = 0; y < h; y++) {
+            for (uint32_t x = 0; x < w; x++) {
+                const size_t i = size_t{y} * w + x;
+                const float u = static_cast<float>(x) / (w - 1);
+                const float v = static_cast<float>(y) / (h - 1);
+                if (config.torus) {
+                    // u around the ring, v around the tube; the grid winding faces outwards
+                    const float theta = 6.2831853f * u, phi = 6.2831853f * v;
+                    const float ring = TORUS_RING + TORUS_TUBE * std::cos(phi);
+                    pos[i * 3 + 0] = 0.5f + ring * std::cos(theta);
+                    pos[i * 3 + 1] = TORUS_TUBE * std::sin(phi);
+                    pos[i * 3 + 2] = 0.5f + ring * std::sin(theta);
+                    norm[i * 3 + 0] = std::cos(phi) * std::cos(theta);
+                    norm[i * 3 + 1] = std::sin(phi);
+                    norm[i * 3 + 2] = std::cos(phi) * std::sin(theta);
+                } else {
+                    pos[i * 3 + 0] = u;
+                    pos[i * 3 + 1] = 0.05f * std::sin(u * 12.0f) * std::cos(v * 12.0f);
+                    pos[i * 3 + 2] = v;
+                    norm[i * 3 + 0] = 0.0f;
+                    norm[i * 3 + 1] = 1.0f;
+                    norm[i * 3 + 2] = 0.0f;
+                }
+                tc[i * 2 + 0] = u;
+                tc[i * 2 + 1] = v;
+            }
+        }
+
+        std::vector<unsigned char> indices{};
+        if (config.unindexed) index_size = 4;
+        if (index_size == 1) append_grid_indices<uint8_t>(w, h, indices);
+        else if (index_size == 2) append_grid_indices<uint16_t>(w, h, indices);
+        else append_grid_indices<uint32_t>(w, h, indices);
+        const size_t nof_indices = indices.size() / index_size;
+        if (config.shuffle_triangles) {
+            // Fisher-Yates over whole triangles, so the winding is kept
+            const size_t triangle_size = 3 * index_size;
+            uint32_t state = config.seed * 2654435761u + 7;
+            std::vector<unsigned char> tmp(triangle_size);
+            for (size_t t = nof_indices / 3; t > 1; t--) {
+                const size_t other = xorshift(state) % t;
+                unsigned char* a = &indices[(t - 1) * triangle_size];
+                unsigned char* b = &indices[other * triangle_size];
+                std::memcpy(tmp.data(), a, triangle_size);
+                std::memcpy(a, b, triangle_size);
+                std::memcpy(b, tmp.data(), triangle_size);
+            }
+        }
+        if (config.unindexed) {
+            std::vector<float> soup_pos(nof_indices * 3), soup_norm(nof_indices * 3), soup_tc(nof_indices * 2);
+            for (size_t k = 0; k < nof_indices; k++) {
+                uint32_t v;
+                std::memcpy(&v, &indices[k * 4], 4);
+                std::memcpy(&soup_pos[k * 3], &pos[size_t{v} * 3], 12);
+                std::memcpy(&soup_norm[k * 3], &norm[size_t{v} * 3], 12);
+                std::memcpy(&soup_tc[k * 2], &tc[size_t{v} * 2], 8);
+            }
+            pos.swap(soup_pos);
+            norm.swap(soup_norm);
+            tc.swap(soup_tc);
+            nof_vertices = nof_indices;
+        }
+
+        std::vector<unsigned char> interleaved{};
+        if (config.stride != 0) {
+            interleaved.assign(nof_vertices * config.stride, 0);
+            for (size_t i = 0; i < nof_vertices; i++) {
+                unsigned char* dst = &interleaved[i * config.stride];
+                std::memcpy(dst + 0, &pos[i * 3], 12);
+                std::memcpy(dst + 12, &norm[i * 3], 12);
+                std::memcpy(dst + 24, &tc[i * 2], 8);
+            }
+        }
+
+        const uint32_t nof_materials = std::max(1u, config.textures);
+        for (uint32_t m = 0; m < config.meshes; m++) {
+            int pos_acc, norm_acc, tc_acc;
+            if (config.stride != 0) {
+                const int view = bin.add_view(interleaved.data(), interleaved.size(), GL_ARRAY_BUFFER, config.stride);
+                pos_acc = add_accessor(view, 0, GL_FLOAT, nof_vertices, "VEC3");
+                norm_acc = add_accessor(view, 12, GL_FLOAT, nof_vertices, "VEC3");
+                tc_acc = add_accessor(view, 24, GL_FLOAT, nof_vertices, "VEC2");
+            } else {
+                pos_acc = add_accessor(bin.add_view(pos.data(), pos.size() * 4, GL_ARRAY_BUFFER), 0, GL_FLOAT, nof_vertices, "VEC3");
+                norm_acc = add_accessor(bin.add_view(norm.data(), norm.size() * 4, GL_ARRAY_BUFFER), 0, GL_FLOAT, nof_vertices, "VEC3");
+                tc_acc = add_accessor(bin.add_view(tc.data(), tc.size() * 4, GL_ARRAY_BUFFER), 0, GL_FLOAT, nof_vertices, "VEC2");
+            }
+            const float height = config.torus ? TORUS_TUBE : 0.05f;
+            accessors[pos_acc]["min"] = {0.0f, -height, 0.0f};
+            accessors[pos_acc]["max"] = {1.0f, height, 1.0f};
+            json prim = {
+                {"attributes", {{"POSITION", pos_acc}, {"NORMAL", norm_acc}, {"TEXCOORD_0", tc_acc}}},
+                {"material", m % nof_materials},
+            };
+            if (!config.unindexed) {
+                prim["indices"] = add_accessor(bin.add_view(indices.data(), indices.size(), GL_ELEMENT_ARRAY_BUFFER),
+                                               0, index_type, nof_indices, "SCALAR");
+            }
+            meshes.push_back({{"primitives", json::array({prim})}});
+
+            const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(config.meshes))));
+            json node = {{"mesh", m}, {"translation", {1.1f * (m % side), 0.0f, 1.1f * (m / side)}}};
+            if (config.gpu_instances > 0) {
+                // random yaw and uniform scale, spread over a square that grows with the count
+                const uint32_t n = config.gpu_instances;
+                const float spread = 1.5f * std::sqrt(static_cast<float>(n));
+                std::vector<float> translations(size_t{n} * 3), rotations(size_t{n} * 4), scales(size_t{n} * 3);
+                uint32_t state = config.seed * 2654435761u + m + 1;
+                const auto uniform = [&]() { return static_cast<float>(xorshift(state) & 0xffff) / 65535.0f; };
+                for (size_t i = 0; i < n; i++) {
+                    translations[i * 3 + 0] = spread * uniform();
+                    translations[i * 3 + 1] = 0.0f;
+                    translations[i * 3 + 2] = spread * uniform();
+                    const float yaw = 6.2831853f * uniform();
+                    rotations[i * 4 + 0] = 0.0f;
+                    rotations[i * 4 + 1] = std::sin(yaw * 0.5f);
+                    rotations[i * 4 + 2] = 0.0f;
+                    rotations[i * 4 + 3] = std::cos(yaw * 0.5f);
+                    const float scale = 0.5f + uniform();
+                    scales[i * 3 + 0] = scales[i * 3 + 1] = scales[i * 3 + 2] = scale;
+                }
+                const int t_acc = add_accessor(bin.add_view(translations.data(), translations.size() * 4, 0), 0, GL_FLOAT, n, "VEC3");
+                const int r_acc = add_accessor(bin.add_view(rotations.data(), rotations.size() * 4, 0), 0, GL_FLOAT, n, "VEC4");
+                const int s_acc = add_accessor(bin.add_view(scales.data(), scales.size() * 4, 0), 0, GL_FLOAT, n, "VEC3");
+                node["extensions"] = {{"EXT_mesh_gpu_instancing", {{"attributes", {
+                    {"TRANSLATION", t_acc}, {"ROTATION", r_acc}, {"SCALE", s_acc}}}}}};
+            }
+            nodes.push_back(node);
+            scene_nodes.push_back(m);
+        }
+
+        json images = json::array();
+        json textures = json::array();
+        json materials = json::array();
+        for (uint32_t t = 0; t < config.textures; t++) {
+            const auto png = make_png(config.texture_size, config.seed + t);
+            images.push_back({{"bufferView", bin.add_view(png.data(), png.size(), 0)}, {"mimeType", "image/png"}});
+            textures.push_back({{"source", t}, {"sampler", 0}});
+            materials.push_back({{"pbrMetallicRoughness", {{"baseColorTexture", {{"index", t}}}}}});
+        }
+        if (config.textures == 0)
+            materials.push_back({{"pbrMetallicRoughness", {{"baseColorFactor", {0.8f, 0.8f, 0.8f, 1.0f}}}}});
+
+        while (bin.bin.size() % 4 != 0)
+            bin.bin.push_back(0);
+
+        json doc = {
+            {"asset", {{"version", "2.0"}, {"generator", "bench_load synthetic"}}},
+            {"scene", 0},
+            {"scenes", json::array({{{"nodes", scene_nodes}}})},
+            {"nodes", nodes},
+            {"meshes", meshes},
+            {"materials", materials},
+            {"accessors", accessors},
+            {"bufferViews", bin.views},
+            {"buffers", json::array({{{"byteLength", bin.bin.size()}}})},
+        };
+        if (config.gpu_instances > 0) {
+            doc["extensionsUsed"] = json::array({"EXT_mesh_gpu_instancing"});
+            doc["extensionsRequired"] = json::array({"EXT_mesh_gpu_instancing"});
+        }
+        if (config.textures > 0) {
+            doc["images"] = images;
+            doc["textures"] = textures;
+            // LINEAR_MIPMAP_LINEAR / LINEAR / REPEAT
+            doc["samplers"] = json::array({{{"minFilter", 9987}, {"magFilter", 9729}, {"wrapS", 10497}, {"wrapT", 10497}}});
+        }
+
+        std::string json_chunk = doc.dump();
+        while (json_chunk.size() % 4 != 0)
+            json_chunk.push_back(' ');
+
+        const auto u32 = [](uint64_t v) { return static_cast<uint32_t>(v); };
+        const uint64_t total = 12 + 8 + json_chunk.size() + 8 + bin.bin.size();
+        if (total > UINT32_MAX) {
+            printf("Synthetic model exceeds the 4 GiB GLB limit.\n");
+            return false;
+        }
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            printf("Failed to open '%s' for writing.\n", path.c_str());
+            return false;
+        }
+        const uint32_t header[3] = {0x46546C67, 2, u32(total)};
+        const uint32_t json_header[2] = {u32(json_chunk.size()), 0x4E4F534A};
+        const uint32_t bin_header[2] = {u32(bin.bin.size()), 0x004E4942};
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(json_header), sizeof(json_header));
+        out.write(json_chunk.data(), json_chunk.size());
+        out.write(reinterpret_cast<const char*>(bin_header), sizeof(bin_header));
+        out.write(reinterpret_cast<const char*>(bin.bin.data()), bin.bin.size());
+        return static_cast<bool>(out);
+    }
+
+}; // end namespace 'bench'
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace bench {
+
+    struct SyntheticConfig {
+        uint32_t meshes{64};
+        // rounded down to a full grid, see write_synthetic_glb()
+        uint32_t vertices_per_mesh{10000};
+        uint32_t textures{8};
+        uint32_t texture_size{1024};
+        // 0 writes POSITION/NORMAL/TEXCOORD_0 as separate tightly packed views,
+        // otherwise one interleaved view with this byteStride (>= 32)
+        uint32_t stride{0};
+        // 8, 16 or 32 bit indices
+        uint32_t index_bits{32};
+        // 0 places each mesh with a plain node, otherwise every mesh node carries EXT_mesh_gpu_instancing
+        // with this many instances scattered around it
+        uint32_t gpu_instances{0};
+        // write the triangles in random order instead of row by row, like a scanned mesh
+        bool shuffle_triangles{false};
+        // wrap each grid into a closed torus, which hides parts of itself from most directions
+        bool torus{false};
+        // write triangle soups without indices: every triangle corner is its own vertex
+        bool unindexed{false};
+        uint32_t seed{1};
+    };
+
+    // Writes a self-contained .glb: one grid mesh per node, one material per texture and
+    // PNG textures filled with a noisy gradient (unique per texture, so nothing dedups).
+    // Each mesh is a w x h vertex grid with w = floor(sqrt(vertices_per_mesh)).
+    bool write_synthetic_glb(const std::filesystem::path& path, const SyntheticConfig& config);
+
+}; // end namespace 'bench'
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "tiny_gltf.h"
+
+// Decoding of glTF accessors into tightly packed, preallocated output.
+// Handles any byteStride, component type, the normalized flag and sparse
+// accessors. Common layouts are dispatched to SSE/AVX2 kernels at runtime.
+namespace accessor {
+
+    using BufferSpans = std::vector<std::span<const unsigned char>>;
+
+    // Resolved view of an accessor's bytes, with all offsets already applied.
+    struct View {
+        const unsigned char* data{nullptr}; // nullptr for accessors without a bufferView (all zeros)
+        size_t count{0};
+        size_t stride{0};                   // bytes between consecutive elements
+        int component_type{-1};             // TINYGLTF_COMPONENT_TYPE_*
+        int num_components{0};              // 1, 2, 3, 4, 9 or 16
+        int column_size{0};                 // bytes per matrix column including padding, 0 for non-matrices
+        bool normalized{false};
+
+        struct Sparse {
+            size_t count{0};
+            const unsigned char* indices{nullptr};
+            int index_component_type{-1};
+            const unsigned char* values{nullptr}; // tightly packed, same layout as the accessor
+        } sparse{};
+    };
+
+    // Resolves and bounds-checks 'acc' against 'buffers'. Returns false on malformed input.
+    bool make_view(const tinygltf::Model& model, const BufferSpans& buffers, const tinygltf::Accessor& acc, View& out);
+
+    // Decodes every component to float (applying normalization). 'out' must hold
+    // view.count * view.num_components floats.
+    bool read_floats(const View& view, float* out);
+
+    // Typed wrappers; return false if the accessor does not have the matching component count.
+    bool read_vec2(const View& view, glm::vec2* out);
+    bool read_vec3(const View& view, glm::vec3* out);
+    bool read_vec4(const View& view, glm::vec4* out);
+
+    // Decodes one POSITION/NORMAL/TEXCOORD_0 triple at once. When all three live in the
+    // same interleaved float bufferView this takes a single pass over the source.
+    // 'norm' and 'tc' may be nullptr if the primitive lacks those attributes.
+    bool read_vertices(const View& pos, const View* norm, const View* tc,
+                       glm::vec3* out_pos, glm::vec3* out_norm, glm::vec2* out_tc);
+
+    // Widens u8/u16/u32 indices to u32 and adds 'base_vertex'. 'out' must hold view.count entries.
+    bool read_indices(const View& view, uint32_t base_vertex, uint32_t* out);
+
+}; // end namespace 'accessor'
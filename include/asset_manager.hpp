@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <unordered_map>
 #include <filesystem>
@@ -7,30 +8,94 @@
 #include "glm/glm.hpp"
 #include "tiny_gltf.h"
 
+#include "accessor.hpp"
+#include "frustum.hpp"
+#include "job_system.hpp"
+#include "load_stats.hpp"
 #include "material.hpp"
+#include "slot_map.hpp"
 #include "texture.hpp"
+#include "transform.hpp"
 
 namespace AssetManager {
 
     constexpr uint32_t POSITION_LOCATION = 0;
     constexpr uint32_t NORMAL_LOCATION = 1;
     constexpr uint32_t TEX_COORD_LOCATION = 2;
+    // Shader storage binding of the per-instance model matrices, indexed by gl_BaseInstance + gl_InstanceID.
+    constexpr uint32_t INSTANCE_BINDING = 2;
 
     const auto path_assets = std::filesystem::current_path() / "assets";
     const auto path_models = path_assets / "models";
 
+    // Coarser levels of detail a mesh can carry, see LoadOptions::lod_levels.
+    constexpr uint32_t MAX_LODS = 8;
+
     struct Model {
         struct Primitive {
+            // An index range that draws the primitive with less detail, see lods.
+            struct Lod {
+                uint32_t offset{0};
+                uint32_t count{0};
+                // object space distance the level may stray from the full detail surface
+                float error{0.0f};
+            };
+
             int32_t mat_idx{-1};
-            glm::mat4x4 model_matrix{1.0f};
-            uint32_t VAO, VBO_pos, VBO_norm, VBO_tc, EBO;
+            // 'count' indices of 'index_type' from index 'offset' (counted in that type) of the model's
+            // geometry, drawn with 'base_vertex'. See place_indices().
             uint32_t offset{0};
             uint32_t count{0};
+            int32_t base_vertex{0};
+            uint32_t index_type{GL_UNSIGNED_INT};
+            // Levels 1..nof_lods, each with fewer triangles than the one before. They index the same
+            // vertices with the same index_type. Level 0 is the full detail range above.
+            std::array<Lod, MAX_LODS> lods{};
+            uint32_t nof_lods{0};
+            // object space bounds of the vertex data
+            glm::vec3 bounds_min{0.0f};
+            glm::vec3 bounds_max{0.0f};
+            // this primitive's range of Model::instances
+            uint32_t first_instance{0};
+            uint32_t instance_count{0};
+
+            [[nodiscard]] Lod lod(uint32_t level) const { return level == 0 ? Lod{offset, count, 0.0f} : lods[level - 1]; }
+        };
+        // One placement of a primitive in the scene: a node referencing its mesh, or one element of
+        // the node's EXT_mesh_gpu_instancing accessors. See update_transforms().
+        struct Instance {
+            static constexpr uint32_t NO_OFFSET = UINT32_MAX;
+
+            glm::mat4x4 model_matrix{1.0f};
+            uint32_t primitive{0};
+            uint32_t node{0};
+            // into Model::instance_offsets, the instance's transform relative to its node
+            uint32_t offset{NO_OFFSET};
+        };
+        // Vertices and indices of all primitives, shared behind one VAO. The vertex buffer holds
+        // all positions, then all normals, then all texture coordinates. Attributes a mesh lacks
+        // are zero-filled, so every primitive has the same vertex format.
+        struct Geometry {
+            uint32_t VAO{0}, VBO{0}, EBO{0};
+            uint32_t nof_vertices{0};
+            // size of the index buffer, which mixes 16 and 32-bit ranges
+            uint64_t index_bytes{0};
         };
         std::vector<Primitive> meshes{};
+        // Grouped by primitive, see Primitive::first_instance. Primitives without instances are not drawn.
+        std::vector<Instance> instances{};
+        // World space bounds of 'instances', same order. See update_transforms().
+        BoundsSoA bounds{};
+        // The loaded scene's nodes. Edit them and call update_transforms() to move the instances.
+        TransformHierarchy nodes{};
+        std::vector<glm::mat4> instance_offsets{};
+        Geometry geometry{};
         std::string name{};
     };
-    extern std::unordered_map<std::string, Model> models;
+    using ModelHandle = SlotMap<Model>::Handle;
+
+    // Loaded models, contiguous for the render loop. Look them up by handle.
+    extern SlotMap<Model> models;
     extern std::vector<Material> materials;
     extern std::vector<Texture> textures;
 
@@ -39,12 +104,199 @@ namespace AssetManager {
         GLTF,
     };
 
-    bool load_model(const std::string name, const FILE_FORMAT format);
+    struct LoadOptions {
+        // Map the .glb into memory and read buffer data straight out of the mapping
+        // instead of having tinygltf copy the BIN chunk. Falls back to the regular
+        // loader if the file references external buffers or images.
+        bool memory_map{false};
+        // Capture the compressed image bytes during parsing and decode all images on the
+        // job system afterwards. Textures are uploaded in the order decoding finishes.
+        bool parallel_images{false};
+        // Print per-image decode times (only with parallel_images).
+        bool report_image_timings{false};
+        // Textures keep only their compressed image until first bound, see Texture::acquire().
+        // Takes precedence over parallel_images.
+        bool lazy_textures{false};
+        // Read the model from a baked .gltfcache next to the source if it is up to date,
+        // otherwise load normally and write one. See model_cache.hpp.
+        bool use_cache{false};
+        // glTF scene to load, -1 for the file's default scene (or the first one if it names none).
+        // Files without scenes load every root node.
+        int32_t scene{-1};
+        // Reorder each primitive's triangles for the post-transform vertex cache (and, unless blended,
+        // for less overdraw) and its vertices for linear fetch while decoding, see
+        // mesh_optimizer.hpp. The result is what gets cached.
+        bool optimize_meshes{false};
+        // Merge duplicate vertices of each primitive while decoding, see mesh_optimizer::weld_vertices().
+        // Primitives without indices are always indexed, this also merges their shared corners.
+        bool weld_vertices{false};
+        // 0 merges only bitwise equal vertices, otherwise the distance within which their attributes merge.
+        float weld_epsilon{0.0f};
+        // Coarser levels of detail to generate per primitive while decoding (at most MAX_LODS), see
+        // mesh_optimizer::generate_lods(). Each aims for lod_ratio of the triangles of the one before.
+        uint32_t lod_levels{0};
+        float lod_ratio{0.5f};
+        // Filled with per-stage timings, bytes and peak heap usage if set.
+        LoadStats* stats{nullptr};
+        // Progress in source bytes, called on the loading thread after each stage and per mesh/image.
+        ProgressCallback progress{};
+    };
+
+    // One span per tinygltf::Model::buffers entry. Either points into Buffer::data
+    // or, for memory mapped files, directly into the mapping.
+    using BufferSpans = accessor::BufferSpans;
+
+    // Returns an invalid handle on failure.
+    ModelHandle load_model(const std::string name, const FILE_FORMAT format, const LoadOptions& options = {});
+    // Frees the model's GL buffers and its slot. Materials and textures stay in the global arrays.
+    bool unload_model(ModelHandle handle);
+    // Name index, meant for load time lookups only.
+    ModelHandle find_model(const std::string& name);
+
+    // Loading an already loaded name returns its existing handle.
+    ModelHandle load_glb(const std::string& name, const LoadOptions& options = {});
+
+    // A level of detail within MeshData::indices.
+    struct MeshLod {
+        uint32_t first{0};
+        uint32_t count{0};
+        float error{0.0f}; // see Model::Primitive::Lod
+    };
+
+    // Non-owning mesh data in upload layout. Points into a MeshData or a mapped cache file.
+    struct MeshSpans {
+        std::span<const glm::vec3> positions{};
+        std::span<const glm::vec3> normals{};
+        std::span<const glm::vec2> texCoords{};
+        std::span<const uint32_t> indices{};
+        std::span<const MeshLod> lods{};
+        glm::vec3 bounds_min{0.0f};
+        glm::vec3 bounds_max{0.0f};
+
+        [[nodiscard]] size_t size_bytes() const
+        {
+            return positions.size_bytes() + normals.size_bytes() + texCoords.size_bytes() + indices.size_bytes();
+        }
+    };
+
+    // CPU side result of decoding one glTF mesh, ready to be uploaded.
+    struct MeshData {
+        std::vector<glm::vec3> positions{};
+        std::vector<glm::vec3> normals{};
+        std::vector<glm::vec2> texCoords{};
+        // the full detail triangles, then those of each level in 'lods'
+        std::vector<uint32_t> indices{};
+        std::vector<MeshLod> lods{};
+        glm::vec3 bounds_min{0.0f};
+        glm::vec3 bounds_max{0.0f};
+
+        // indices of the full detail triangles
+        [[nodiscard]] uint32_t base_count() const { return lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].first; }
+        [[nodiscard]] MeshSpans spans() const { return {positions, normals, texCoords, indices, lods, bounds_min, bounds_max}; }
+    };
+
+    struct BakedModel;
+
+    struct DecodedImage {
+        size_t image_idx{0};
+        bool ok{false};
+        double decode_ms{0.0};
+        size_t compressed_size{0};
+        tinygltf::Image image{};
+    };
+
+    // Images decoding on the job system, drained by load_glb_textures.
+    struct ImageBatch {
+        ~ImageBatch();
+        CompletionQueue<DecodedImage> finished{};
+        size_t nof_jobs{0};
+        bool report{false};
+    };
+
+    // tinygltf image loader that only stores the compressed bytes for later decoding.
+    bool capture_image_bytes(tinygltf::Image* image, const int image_idx, std::string* err, std::string* warn,
+                             int req_width, int req_height, const unsigned char* bytes, int size, void* user_data);
+    // Decodes every image, or only those flagged in 'needed'.
+    void start_image_decode(const tinygltf::Model& model, const BufferSpans& buffers, ImageBatch& batch,
+                            const std::vector<bool>* needed = nullptr);
+
+    // Which AssetManager::textures entry each glTF texture ends up as. Textures the materials sample
+    // are grouped into one slot per distinct (image content, sampler); slots whose content an earlier
+    // load already uploaded are resolved up front and their images are neither decoded nor uploaded.
+    struct TexturePlan {
+        struct Slot {
+            int image{-1};
+            Texture::TextureConfig sampler{};
+            // hash of the image bytes and sampler, 0 if the image has no bytes to hash
+            uint64_t content_key{0};
+            int32_t texture_idx{-1};
+        };
+        std::vector<Slot> slots{};
+        std::vector<int32_t> slot_of_texture{}; // -1 for textures no material samples
+        std::vector<bool> decode_image{};       // images some unresolved slot still needs
+    };
+    TexturePlan plan_textures(const tinygltf::Model& model, const BufferSpans& buffers);
+
+    // Content key -> AssetManager::textures index of every texture loaded so far, shared across
+    // models. Clear it whenever 'textures' is cleared.
+    int32_t find_cached_texture(uint64_t content_key);
+    void cache_texture(uint64_t content_key, int32_t texture_idx);
+    void clear_texture_cache();
+
+    // Fills m.meshes with one Primitive per glTF primitive, mesh after mesh. With a non-null 'bake',
+    // the decoded data is kept for writing the model cache. Of 'options' only the mesh processing
+    // (weld_vertices, weld_epsilon, lod_levels, lod_ratio, optimize_meshes) is used.
+    bool load_glb_meshes(Model& m, const tinygltf::Model& model, const BufferSpans& buffers,
+                         BakedModel* bake = nullptr, LoadTracker* tracker = nullptr, const LoadOptions& options = {});
+    // Thread safe, touches no GL state. A primitive without POSITION decodes to no vertices.
+    bool decode_glb_primitive(const tinygltf::Model& model, const BufferSpans& buffers, const tinygltf::Primitive& primitive,
+                              MeshData& out);
+    // Vertex and index count of a primitive as decode_glb_primitive() lays it out. Primitives without
+    // indices get one per vertex.
+    void primitive_element_counts(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+                                  uint64_t& nof_vertices, uint64_t& nof_indices);
+    // Meshes with at most this many vertices get 16-bit indices.
+    constexpr uint64_t MAX_SHORT_INDEXED_VERTICES = uint64_t{UINT16_MAX} + 1;
+    [[nodiscard]] inline uint32_t index_size(uint32_t index_type) { return index_type == GL_UNSIGNED_SHORT ? 2 : 4; }
+    // Gives 'p' the next range of the index buffer for 'nof_indices' indices into 'nof_vertices' vertices:
+    // sets p.index_type to the narrowest type that fits and p.offset, then advances 'index_bytes' past it.
+    void place_indices(Model::Primitive& p, uint64_t nof_vertices, uint64_t nof_indices, uint64_t& index_bytes);
+    // Allocates a model's shared vertex/index buffers and sets up their VAO. Must run on the thread owning the GL context.
+    bool create_geometry(Model::Geometry& g, uint64_t nof_vertices, uint64_t index_bytes);
+    void destroy_geometry(Model::Geometry& g);
+    // Writes one mesh into its range of 'g', starting at p.base_vertex and index p.offset, narrowing the
+    // indices to p.index_type, and fills in p's count, levels of detail and bounds. Must run on the
+    // thread owning the GL context.
+    bool upload_mesh(const Model::Geometry& g, Model::Primitive& p, const MeshSpans& data);
+    // Creates one Texture per unresolved slot of 'plan'; texture_table maps glTF texture -> AssetManager::textures.
+    // With a batch, images are taken from it as they finish decoding.
+    bool load_glb_textures(
+        const tinygltf::Model& model,
+        const BufferSpans& buffers,
+        const LoadOptions& options,
+        ImageBatch* batch,
+        TexturePlan& plan,
+        std::vector<int32_t>& texture_table,
+        BakedModel* bake = nullptr,
+        LoadTracker* tracker = nullptr
+    );
+    // Creates one Material per glTF material the primitives use and sets every m.meshes entry's mat_idx;
+    // primitives sharing a glTF material share its index.
+    bool load_glb_materials(Model& m, const tinygltf::Model& model, const std::vector<int32_t>& texture_table);
+    // Flattens the selected scene's node tree into m.nodes and adds one instance per node that
+    // references a mesh, or one per element of the node's EXT_mesh_gpu_instancing accessors, for
+    // each of the mesh's primitives. m.meshes must already hold them, see load_glb_meshes().
+    // The instances' model matrices are set by the next update_transforms().
+    bool load_glb_transformations(Model& m, const tinygltf::Model& model, const BufferSpans& buffers,
+                                  int32_t scene = -1);
+    // Sorts m.instances by primitive and sets every primitive's instance range.
+    void group_instances(Model& m);
+    // Updates the world matrices of m.nodes' dirty subtrees, then the model matrices and bounds of
+    // the instances below them. Cheap when nothing changed, meant to be called every frame.
+    void update_transforms(Model& m);
 
-    bool load_glb(const std::string& name);
-    bool load_glb_meshes(Model& m, const tinygltf::Model& model);
-    bool load_glb_materials(Model& m, const tinygltf::Model& model);
-    bool load_glb_transformations(Model& m, const tinygltf::Model& model);
+    // Cached 1x1 texture of 'color', bound in place of lazy textures that are still decoding.
+    uint32_t placeholder_texture(const glm::vec4& color);
 
     glm::mat4x4 vec_to_glm_mat4x4(const std::vector<double>& mat);
     glm::mat4 get_node_transform(const tinygltf::Node& node);
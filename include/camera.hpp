@@ -23,6 +23,8 @@ struct Camera
     float aspect_ratio{ 1.0f };
     float near_plane{ 0.01f };
     float far_plane{ 300.0f };
+    // framebuffer height in pixels, for screen space measures like LodSelector
+    float viewport_height{ 1.0f };
 
     float movement_speed{ 5.0f };
     float rotation_speed{ 0.05f };
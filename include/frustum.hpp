@@ -0,0 +1,35 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// World space AABBs as center/extent, one array per component so the culling kernels can
+// test 8 boxes per AVX2 iteration (4 with SSE) with plain loads.
+struct BoundsSoA {
+    std::vector<float> center_x{}, center_y{}, center_z{};
+    std::vector<float> extent_x{}, extent_y{}, extent_z{};
+
+    void resize(size_t n);
+    [[nodiscard]] size_t size() const { return center_x.size(); }
+    // Stores the world space AABB of the object space box [min, max] under 'transform'.
+    void set(size_t i, const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max);
+};
+
+// The six planes of a view frustum, normals pointing inwards: a point p is inside a plane
+// if dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+    glm::vec4 planes[6]{};
+
+    // Gribb/Hartmann extraction from a projection * view matrix.
+    static Frustum from_matrix(const glm::mat4& PV);
+};
+
+// Writes 1 to visible[i] if box i intersects the frustum, 0 otherwise. Conservative: boxes
+// near a frustum corner can pass although they are outside. Splits the work across the job
+// system once there are PARALLEL_CULL_THRESHOLD boxes or more.
+void cull(const Frustum& frustum, const BoundsSoA& bounds, uint8_t* visible);
+
+constexpr size_t PARALLEL_CULL_THRESHOLD = 16384;
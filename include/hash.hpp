@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// FNV-1a style hash over 64-bit words. Fast enough to run over whole files and
+// images; used for change detection and content keys, not for security.
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+{
+    constexpr uint64_t prime = 0x100000001b3ull;
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ 0xcbf29ce484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, bytes + i, sizeof(w));
+        h = (h ^ w) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++)
+        h = (h ^ bytes[i]) * prime;
+    return h;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "glad.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+#include "frustum.hpp"
+#include "lod.hpp"
+#include "material_buffer.hpp"
+#include "shader.hpp"
+#include "stream_buffer.hpp"
+
+// Alternative to the render queue in main.cpp. Every frame it writes one DrawElementsIndirectCommand
+// per primitive and level of detail with visible instances into a GL buffer, the per-draw material
+// index and the instances' model matrices into SSBOs, and submits each model with
+// glMultiDrawElementsIndirect. Each command draws all visible instances of its primitive at its
+// level, base_instance points at the first. Levels share the primitive's vertices and index type,
+// so they stay in its batch.
+//
+// Draws that sample different textures or need a different cull mode cannot share one
+// multi-draw without bindless textures, so each model is split into batches by
+// (double sided, base color texture, metallic/roughness texture, index type). With deduplicated
+// materials and textures that is a handful of batches per model, independent of the
+// number of primitives. Blended primitives are left out of those batches: their instances are
+// drawn afterwards with blending on, one command each, back to front over all models, in
+// batches of consecutive commands that share the state above. Expects indirect.vert/indirect.frag.
+class IndirectRenderer {
+public:
+    // matches the GL definition, see glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t base_instance;
+    };
+
+    // std430 layout of 'struct Draw' in indirect.vert
+    struct DrawRecord {
+        uint32_t material;
+    };
+
+    struct Stats {
+        uint32_t draws{0};
+        uint32_t instances{0};
+        uint32_t culled{0}; // instances
+        uint32_t batches{0};
+        uint32_t texture_binds{0};
+        uint64_t triangles{0}; // over all instances, at the level of detail they were drawn with
+    };
+
+    // 'shader' must be the indirect shader; it and 'materials' must outlive the renderer.
+    IndirectRenderer(const Shader& shader, MaterialBuffer& materials);
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // Draws all loaded models, skipping primitives outside 'frustum' if given, each instance at the
+    // level of detail 'lod' selects, or full detail without one. Blended instances are sorted by
+    // their distance from 'eye'. The shader's u_PV and u_CameraPosition must already be set.
+    void draw(const glm::vec3& eye, const Frustum* frustum = nullptr, const LodSelector* lod = nullptr);
+    [[nodiscard]] const Stats& stats() const { return frame_stats; }
+
+private:
+    static constexpr GLuint DRAW_BINDING = 0;
+
+    struct Batch {
+        GLuint VAO{0};
+        uint32_t first_command{0};
+        uint32_t nof_commands{0};
+        int32_t base_color_texture_idx{-1};
+        int32_t metallic_roughness_texture_idx{-1};
+        bool double_sided{false};
+        glm::vec4 base_color{1.0f}; // for the placeholder while the texture is still decoding
+        // one multi-draw has one index type, first_index counts indices of it
+        GLenum index_type{GL_UNSIGNED_INT};
+        bool blend{false};
+    };
+
+    // a visible instance of a blended primitive
+    struct Transparent {
+        float distance; // of its bounds center from the eye
+        const AssetManager::Model* model;
+        uint32_t primitive;
+        uint32_t instance;
+    };
+
+    const Shader& shader;
+    MaterialBuffer& materials;
+    Uniform<int> u_base_color_texture{}, u_metallic_roughness_texture{};
+    Uniform<uint32_t> u_draw_offset{};
+
+    StreamBuffer command_buffer{GL_DRAW_INDIRECT_BUFFER};
+    StreamBuffer draw_buffer{GL_SHADER_STORAGE_BUFFER};
+    StreamBuffer instance_buffer{GL_SHADER_STORAGE_BUFFER};
+
+    // rebuilt every frame, kept around to reuse their memory
+    std::vector<DrawElementsIndirectCommand> command_data{};
+    std::vector<DrawRecord> draw_data{};
+    std::vector<glm::mat4> instance_data{};
+    std::vector<Batch> batches{};
+    std::vector<uint32_t> order{};
+    std::vector<uint8_t> visible{};
+    // visible instances of the primitive being recorded with their level of detail
+    std::vector<std::pair<uint32_t, uint32_t>> instance_levels{};
+    std::vector<Transparent> transparent{};
+    Stats frame_stats{};
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Small work-stealing thread pool. Each worker owns a deque; it pops its own work
+// from the back and steals from the front of the other workers' deques when idle.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // 0 means one worker per hardware thread.
+    explicit JobSystem(size_t nof_workers = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Pushes onto the calling worker's own deque, or round-robin when called from outside the pool.
+    void submit(Job job);
+
+    // Runs one pending job on the calling thread. Returns false if there was nothing to run.
+    bool run_one();
+
+    // Calls fn(i) for i in [0, count) across the pool and blocks until all calls returned.
+    // The calling thread helps out instead of idling.
+    void parallel_for(size_t count, const std::function<void(size_t)>& fn, size_t grain = 1);
+
+    [[nodiscard]] size_t size() const { return threads.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next_queue{0};
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    bool try_pop(size_t queue_idx, Job& job);
+    bool try_steal(size_t thief_idx, Job& job);
+    void worker_loop(size_t idx);
+};
+
+// Process wide pool shared by the loaders.
+JobSystem& job_system();
+
+// Multi-producer queue that hands finished results to a single consumer in completion order.
+template <typename T>
+class CompletionQueue {
+public:
+    void push(T value)
+    {
+        // notify under the lock: the consumer may destroy the queue as soon as it sees the last item
+        std::lock_guard lock(mutex);
+        items.push_back(std::move(value));
+        ready.notify_one();
+    }
+
+    // Blocks until an item is available.
+    T pop()
+    {
+        std::unique_lock lock(mutex);
+        ready.wait(lock, [this] { return !items.empty(); });
+        T value = std::move(items.front());
+        items.pop_front();
+        return value;
+    }
+
+    std::optional<T> try_pop()
+    {
+        std::lock_guard lock(mutex);
+        if (items.empty())
+            return std::nullopt;
+        T value = std::move(items.front());
+        items.pop_front();
+        return value;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<T> items;
+};
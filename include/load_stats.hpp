@@ -0,0 +1,187 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+enum class LoadStage : uint32_t {
+    FILE_READ,
+    JSON_PARSE,
+    BUFFER_DECODE,
+    IMAGE_DECODE,
+    MESH_UPLOAD,
+    TEXTURE_UPLOAD,
+    TRANSFORM_BUILD,
+    COUNT,
+};
+constexpr size_t NOF_LOAD_STAGES = static_cast<size_t>(LoadStage::COUNT);
+
+const char* to_string(LoadStage stage);
+
+struct StageStats {
+    // Wall time on the loading thread while the stage was open. BUFFER_DECODE and
+    // IMAGE_DECODE run on the job system and overlap the upload stages.
+    double ms{0.0};
+    // Input bytes for parse/decode stages, bytes handed to GL for upload stages.
+    uint64_t bytes{0};
+    // Highest heap usage above the start of the load while the stage was open, as alloc_stats counts it.
+    uint64_t peak_alloc_bytes{0};
+};
+
+// Post-transform vertex cache simulation over all meshes of a load, before and after the
+// reordering of LoadOptions::optimize_meshes. Only filled in when that option is set.
+struct VertexCacheStats {
+    uint64_t triangles{0};
+    uint64_t vertices{0}; // referenced by at least one triangle
+    uint64_t transformed_before{0};
+    uint64_t transformed_after{0};
+    // summed over the job system's threads
+    double optimize_ms{0.0};
+
+    // average cache miss ratio: transformed vertices per triangle, 0.5 at best
+    [[nodiscard]] double acmr_before() const { return triangles ? double(transformed_before) / triangles : 0.0; }
+    [[nodiscard]] double acmr_after() const { return triangles ? double(transformed_after) / triangles : 0.0; }
+    // average transform to vertex ratio: transformed vertices per vertex, 1.0 at best
+    [[nodiscard]] double atvr_before() const { return vertices ? double(transformed_before) / vertices : 0.0; }
+    [[nodiscard]] double atvr_after() const { return vertices ? double(transformed_after) / vertices : 0.0; }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& o);
+};
+
+// Vertices over all meshes of a load before and after LoadOptions::weld_vertices. Only filled in
+// when that option is set.
+struct WeldStats {
+    uint64_t vertices_before{0};
+    uint64_t vertices_after{0};
+    // summed over the job system's threads
+    double weld_ms{0.0};
+
+    // fraction of the vertices that were duplicates
+    [[nodiscard]] double reduction() const { return vertices_before ? 1.0 - double(vertices_after) / vertices_before : 0.0; }
+
+    WeldStats& operator+=(const WeldStats& o);
+};
+
+// Triangles over all meshes of a load at full detail and at their coarsest generated level, see
+// LoadOptions::lod_levels. Only filled in when that option is set; meshes without levels count
+// their full detail triangles as the coarsest.
+struct LodStats {
+    uint64_t meshes_with_lods{0};
+    uint64_t levels{0};
+    uint64_t triangles{0};
+    uint64_t coarsest_triangles{0};
+    // summed over the job system's threads
+    double lod_ms{0.0};
+
+    // fraction of the triangles the coarsest levels leave out
+    [[nodiscard]] double reduction() const { return triangles ? 1.0 - double(coarsest_triangles) / triangles : 0.0; }
+
+    LodStats& operator+=(const LodStats& o);
+};
+
+struct LoadStats {
+    std::array<StageStats, NOF_LOAD_STAGES> stages{};
+    VertexCacheStats vertex_cache{};
+    WeldStats weld{};
+    LodStats lods{};
+    double total_ms{0.0};
+    uint64_t file_bytes{0};
+    uint64_t peak_alloc_bytes{0};
+    // Cache hits skip all stages, only the totals are filled in.
+    bool from_cache{false};
+
+    StageStats& operator[](LoadStage s) { return stages[static_cast<size_t>(s)]; }
+    const StageStats& operator[](LoadStage s) const { return stages[static_cast<size_t>(s)]; }
+};
+
+// One line per stage, for logs.
+void print_load_stats(const std::string& name, const LoadStats& stats);
+
+struct LoadProgress {
+    LoadStage stage{};
+    // Source file bytes handled so far: the JSON chunk, then each mesh's accessor
+    // data and each compressed image as it is uploaded. Reaches bytes_total when done.
+    uint64_t bytes_done{0};
+    uint64_t bytes_total{0};
+    double elapsed_ms{0.0};
+    double bytes_per_sec{0.0};
+};
+
+// Called on the loading thread.
+using ProgressCallback = std::function<void(const LoadProgress&)>;
+
+// Heap accounting behind peak_alloc_bytes. Counts stb_image's allocations, and operator new/delete
+// in builds that link bench/counted_new.cpp (bench_load, the viewer keeps the default allocator).
+// Only counts while a LoadTracker with stats is alive; otherwise an allocation costs one relaxed
+// load on top of malloc. The counters are process wide, so allocations of other threads during a
+// tracked load are included.
+namespace alloc_stats {
+
+    // Counting is on while there are more begin_counting() than end_counting() calls. The
+    // counters restart from zero whenever it turns on.
+    void begin_counting();
+    void end_counting();
+
+    // Net bytes allocated since counting turned on, 0 if more was freed.
+    uint64_t live_bytes();
+    // Highest live_bytes() since the last call, then starts over from the current value.
+    uint64_t take_peak();
+
+    void* counted_malloc(size_t size);
+    void* counted_realloc(void* ptr, size_t size);
+    void* counted_aligned_alloc(size_t alignment, size_t size);
+    void counted_free(void* ptr);
+
+}; // end namespace 'alloc_stats'
+
+// Fills a LoadStats and drives the progress callback for one load. Stages may be opened and
+// closed repeatedly and may overlap; their times add up. Only used on the loading thread.
+class LoadTracker {
+public:
+    LoadTracker(LoadStats* stats, const ProgressCallback* progress);
+    ~LoadTracker();
+    LoadTracker(const LoadTracker&) = delete;
+    LoadTracker& operator=(const LoadTracker&) = delete;
+
+    [[nodiscard]] bool active() const { return stats != nullptr || progress != nullptr; }
+
+    void begin(LoadStage stage);
+    // 'exclude_ms' is subtracted again, for work that is accounted to a nested stage.
+    void end(LoadStage stage, uint64_t bytes = 0, double exclude_ms = 0.0);
+    [[nodiscard]] double stage_ms(LoadStage stage) const { return local[static_cast<size_t>(stage)].ms; }
+
+    void set_total(uint64_t file_bytes);
+    void add_vertex_cache_stats(const VertexCacheStats& s) { vertex_cache += s; }
+    void add_weld_stats(const WeldStats& s) { weld += s; }
+    void add_lod_stats(const LodStats& s) { lods += s; }
+    void advance(LoadStage stage, uint64_t source_bytes);
+    void finish(bool from_cache);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Open {
+        bool open{false};
+        Clock::time_point start{};
+        uint64_t peak{0};
+    };
+
+    LoadStats* stats;
+    const ProgressCallback* progress;
+    Clock::time_point start{Clock::now()};
+    uint64_t baseline{0};
+    uint64_t overall_peak{0};
+    uint64_t bytes_total{0};
+    uint64_t bytes_done{0};
+    std::array<StageStats, NOF_LOAD_STAGES> local{};
+    std::array<Open, NOF_LOAD_STAGES> windows{};
+    VertexCacheStats vertex_cache{};
+    WeldStats weld{};
+    LodStats lods{};
+
+    void fold_peak();
+    void report(LoadStage stage);
+};
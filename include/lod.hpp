@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+
+#include "asset_manager.hpp"
+#include "camera.hpp"
+
+// Picks a primitive's level of detail per instance from the screen space error it would cause:
+// the level's object space error, scaled by the instance transform, projected at the distance of
+// the nearest point of the instance's bounding sphere. The coarsest level that stays within
+// max_pixel_error is drawn. See AssetManager::LoadOptions::lod_levels.
+struct LodSelector {
+    glm::vec3 eye{0.0f};
+    // pixels a world space unit covers at distance 1
+    float pixels_per_unit{1.0f};
+    // distances are clamped to this, the camera inside a sphere sees it at full detail
+    float near_plane{0.01f};
+    float max_pixel_error{1.0f};
+
+    // Screen height and vertical field of view of 'camera'.
+    static LodSelector from_camera(const Camera& camera, float max_pixel_error = 1.0f);
+
+    // Level of model.meshes[primitive] to draw for model.instances[instance], 0 is full detail.
+    [[nodiscard]] uint32_t select(const AssetManager::Model& model, const AssetManager::Model::Primitive& primitive,
+                                  uint32_t instance) const;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of an entire file. Pages are faulted in by the OS
+// on first access, so nothing is copied until the bytes are actually read.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return mapping != nullptr; }
+    [[nodiscard]] const unsigned char* data() const { return mapping; }
+    [[nodiscard]] size_t size() const { return mapping_size; }
+    [[nodiscard]] std::span<const unsigned char> bytes() const { return {mapping, mapping_size}; }
+
+private:
+    const unsigned char* mapping{nullptr};
+    size_t mapping_size{0};
+};
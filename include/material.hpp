@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include "glm/vec4.hpp"
+#include "std430.hpp"
 
 struct Material {
     Material() = default;
@@ -18,4 +22,47 @@ struct Material {
     int32_t metallic_roughness_texture_idx{-1};
     int32_t normal_texture_idx{-1};
     int32_t emissive_texture_idx{-1};
-};
\ No newline at end of file
+};
+
+// What the shaders see of a Material: one element of the Materials storage buffer
+// (see MaterialBuffer). Must match 'struct Material' in default.frag and indirect.frag.
+struct GpuMaterial {
+    enum Flags : uint32_t {
+        DOUBLE_SIDED = 1u << 0,
+        HAS_BASE_COLOR_TEXTURE = 1u << 1,
+        HAS_METALLIC_ROUGHNESS_TEXTURE = 1u << 2,
+        ALPHA_MASK = 1u << 3,
+        ALPHA_BLEND = 1u << 4,
+    };
+
+    glm::vec4 base_color;
+    float metalness;
+    float roughness;
+    float alpha_cutoff;
+    uint32_t flags;
+
+    static GpuMaterial from(const Material& m)
+    {
+        uint32_t flags = 0;
+        if (m.double_sided) flags |= DOUBLE_SIDED;
+        if (m.base_color_texture_idx != -1) flags |= HAS_BASE_COLOR_TEXTURE;
+        if (m.metallic_roughness_texture_idx != -1) flags |= HAS_METALLIC_ROUGHNESS_TEXTURE;
+        if (m.mode == Material::AlphaMode::MASK) flags |= ALPHA_MASK;
+        if (m.mode == Material::AlphaMode::BLEND) flags |= ALPHA_BLEND;
+        return {m.base_color, m.metalness, m.roughness, m.alpha_cutoff, flags};
+    }
+};
+
+// The member types of GpuMaterial in declaration order; the layout checks below fail to
+// compile if the C++ struct drifts from what std430 gives the GLSL one.
+namespace gpu_material_layout {
+    constexpr auto offsets = std430::offsets<glm::vec4, float, float, float, uint32_t>();
+    constexpr size_t stride = std430::struct_size<glm::vec4, float, float, float, uint32_t>();
+}; // end namespace 'gpu_material_layout'
+
+static_assert(offsetof(GpuMaterial, base_color) == gpu_material_layout::offsets[0]);
+static_assert(offsetof(GpuMaterial, metalness) == gpu_material_layout::offsets[1]);
+static_assert(offsetof(GpuMaterial, roughness) == gpu_material_layout::offsets[2]);
+static_assert(offsetof(GpuMaterial, alpha_cutoff) == gpu_material_layout::offsets[3]);
+static_assert(offsetof(GpuMaterial, flags) == gpu_material_layout::offsets[4]);
+static_assert(sizeof(GpuMaterial) == gpu_material_layout::stride);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "glad.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "material.hpp"
+
+// AssetManager::materials mirrored into one shader storage buffer of GpuMaterial, so shaders
+// look materials up by index instead of getting their factors as uniforms per draw. One extra
+// element past the end holds a default Material for primitives without one.
+class MaterialBuffer {
+public:
+    static constexpr GLuint BINDING = 1;
+
+    MaterialBuffer();
+    ~MaterialBuffer();
+    MaterialBuffer(const MaterialBuffer&) = delete;
+    MaterialBuffer& operator=(const MaterialBuffer&) = delete;
+
+    // Uploads the materials if any were added or cleared since the last call, or after
+    // invalidate(), and binds the buffer to BINDING.
+    void sync();
+    // For materials edited in place, which sync() cannot detect.
+    void invalidate() { dirty = true; }
+
+    // Index into the buffer for a primitive's mat_idx, -1 maps to the default material.
+    [[nodiscard]] uint32_t index_of(int32_t mat_idx) const
+    {
+        return mat_idx >= 0 ? static_cast<uint32_t>(mat_idx) : static_cast<uint32_t>(uploaded);
+    }
+
+private:
+    GLuint ID{0};
+    size_t capacity{0};
+    size_t uploaded{0};
+    bool dirty{true};
+    std::vector<GpuMaterial> records{};
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "asset_manager.hpp"
+#include "glm/glm.hpp"
+
+// Load-time processing of decoded meshes, see LoadOptions::weld_vertices, LoadOptions::lod_levels
+// and LoadOptions::optimize_meshes. Welding merges duplicate vertices and LOD generation appends
+// coarser index ranges; the other passes keep the triangles and only change their order and the
+// vertex numbering.
+namespace mesh_optimizer {
+
+    // Entries of the FIFO post-transform cache that the optimizer targets and the statistics
+    // simulate. Small enough to help the batch based caches of current GPUs as well.
+    constexpr uint32_t CACHE_SIZE = 16;
+
+    // Vertices a FIFO cache of 'cache_size' entries would transform to draw 'indices'.
+    // ACMR is this over the triangle count, ATVR this over the referenced vertex count.
+    uint64_t simulate_vertex_cache(std::span<const uint32_t> indices, size_t nof_vertices,
+                                   uint32_t cache_size = CACHE_SIZE);
+    // Vertices referenced by at least one index.
+    uint64_t count_referenced(std::span<const uint32_t> indices, size_t nof_vertices);
+
+    // Tipsify (Sander, Nehab, Barczak 2007): reorders whole triangles, keeping their winding,
+    // so that vertices are reused while still in the cache. Linear in the index count.
+    void optimize_vertex_cache(std::span<uint32_t> indices, size_t nof_vertices, uint32_t cache_size = CACHE_SIZE);
+
+    // Default for optimize_overdraw(): clusters may be up to 5% worse for the cache than the
+    // order they were cut from.
+    constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    // Sander, Nehab, Barczak 2007, section 4: cuts the (cache optimized) triangle order into
+    // clusters wherever the cache would be cold anyway, or 'threshold' times the ACMR allows,
+    // then draws the clusters facing away from the mesh center first. Those tend to occlude the
+    // rest from most viewpoints, so an opaque mesh shades fewer hidden fragments. Triangles keep
+    // their order and winding inside a cluster.
+    void optimize_overdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions,
+                           float threshold = OVERDRAW_THRESHOLD, uint32_t cache_size = CACHE_SIZE);
+
+    // Merges vertices whose position, normal and texture coordinate are all bitwise equal and
+    // rewrites the indices to match. The first vertex of each group is kept, in order. With
+    // 'epsilon' > 0 a vertex instead joins the earliest group whose kept vertex has each of the
+    // three attributes within a distance of 'epsilon' of its own; the kept vertex keeps its exact
+    // values. Adds the mesh's vertex counts to 'stats'. Leaves the mesh untouched if an index is
+    // out of range.
+    void weld_vertices(AssetManager::MeshData& mesh, WeldStats& stats, float epsilon = 0.0f);
+
+    // Renumbers the vertices in order of first use by the indices, so the vertex fetch walks
+    // the attribute arrays front to back. Unreferenced vertices keep their order at the end.
+    void optimize_vertex_fetch(AssetManager::MeshData& mesh);
+
+    // Bounds for LoadOptions::lod_ratio, every level must remove at least a tenth of the triangles.
+    constexpr float LOD_MIN_RATIO = 0.05f;
+    constexpr float LOD_MAX_RATIO = 0.9f;
+    // Weight of the planes that hold border edges in place, relative to the surface planes.
+    constexpr double LOD_BORDER_WEIGHT = 10.0;
+
+    // Appends up to 'nof_levels' coarser copies of the triangles to mesh.indices and describes them
+    // in mesh.lods, each aiming for 'ratio' of the triangles of the one before. Simplifies by
+    // quadric error (Garland, Heckbert 1997) with half-edge collapses, which move a position onto a
+    // neighbouring one, so the levels index the existing vertices and share the vertex buffer.
+    // Positions on non-manifold edges never move, borders only along themselves, and a collapse
+    // that would leave a vertex without a matching one to take its normal and texture coordinate
+    // from (a seam crossing the edge) is skipped. The chain ends early once a level cannot get
+    // below nine tenths of the one before. Adds the mesh's triangle counts to 'stats'. Leaves the
+    // mesh untouched if it already has levels, is not a triangle list or an index is out of range.
+    void generate_lods(AssetManager::MeshData& mesh, LodStats& stats, uint32_t nof_levels, float ratio);
+
+    // The reordering passes above in order: cache, overdraw (only if 'opaque', blended meshes are drawn
+    // back to front per instance and gain nothing), fetch. Each level of detail is reordered on its
+    // own. Adds the full detail range's before/after statistics to 'stats'. Leaves the mesh
+    // untouched if it is not a triangle list or an index is out of range.
+    void optimize(AssetManager::MeshData& mesh, VertexCacheStats& stats, bool opaque = true);
+
+}; // end namespace 'mesh_optimizer'
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "asset_manager.hpp"
+#include "texture.hpp"
+
+// Baked binary model cache (.gltfcache).
+//
+// Stores a loaded model in its final upload layout: per-primitive vertex/index arrays,
+// the node hierarchy and instances, materials and texture payloads (decoded pixels, or the
+// compressed image for lazy textures). A cache hit maps the file and streams it
+// straight into GL without going through tinygltf.
+namespace AssetManager {
+
+    // Bump whenever the on-disk layout or anything that feeds into it changes.
+    constexpr uint32_t CACHE_VERSION = 9;
+
+    // Everything collected during a regular load that the cache needs besides
+    // the Model/materials already stored in the global arrays.
+    struct BakedModel {
+        struct BakedTexture {
+            Texture::TextureConfig conf{};
+            bool compressed{false};
+            // compressed image of a texture shared with an earlier load, decoded when the cache is read
+            bool decode_on_load{false};
+            uint64_t content_key{0};
+            // the AssetManager::textures entry the materials reference
+            int32_t texture_idx{-1};
+            std::vector<unsigned char> payload{};
+        };
+
+        std::vector<MeshData> meshes{};
+        std::vector<BakedTexture> textures{};
+    };
+
+    std::filesystem::path cache_path(const std::filesystem::path& source);
+
+    // Hash of the source file contents, CACHE_VERSION and the options that change the baked output.
+    bool compute_cache_key(const std::filesystem::path& source, const LoadOptions& options, uint64_t& key);
+
+    // Fills 'm' from the cache. Returns false (without side effects) if the cache is missing, stale or corrupt,
+    // or its geometry fails to upload.
+    bool load_cached_model(Model& m, const std::filesystem::path& cache, uint64_t key);
+
+    // 'material_base' is the size of the material array before the model was loaded. Textures
+    // are matched up through BakedTexture::texture_idx, they may be shared with other models.
+    bool write_cached_model(
+        const Model& model,
+        const std::filesystem::path& cache,
+        uint64_t key,
+        const BakedModel& bake,
+        size_t material_base
+    );
+
+}; // end namespace 'AssetManager'
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "glad.h"
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_manager.hpp"
+#include "frustum.hpp"
+#include "lod.hpp"
+#include "material_buffer.hpp"
+#include "shader.hpp"
+#include "stream_buffer.hpp"
+
+// Sorted submission for the per-primitive draw path. Each frame the primitives are pushed as
+// packets with a 64-bit sort key, radix sorted, and drawn in key order while only issuing the
+// GL calls whose state actually differs from the previous packet.
+//
+// An opaque packet draws every visible instance of its primitive at one level of detail with one
+// instanced call, the model matrices are read from an SSBO at gl_BaseInstance + gl_InstanceID.
+// Transparent instances get a packet each since they have to be ordered by depth individually.
+//
+// Opaque key, most significant first:
+//   pass:2 | alpha mode:2 | cull:1 | pipeline:3 | texture set:12 | material:12 | VAO:8 | depth:24
+// Texture binds cost more than a material switch (one uniform, the factors live in the
+// MaterialBuffer), so the texture set sorts above the material. Depth is front to back.
+// Transparent packets put back-to-front depth right below the pass so they blend correctly:
+//   pass:2 | inverted depth:24 | alpha mode:2 | cull:1 | pipeline:3 | texture set:12 | material:12 | VAO:8
+// Texture sets and VAOs get dense ids numbered from begin(), so they only overflow their bits
+// past 4096 texture sets or 256 VAOs in one frame. Fields wider than their bits are truncated.
+// The key only orders packets; submit() compares the real state, so a truncated field costs
+// extra transitions, never a wrong draw.
+class RenderQueue {
+public:
+    enum class Pass : uint8_t { OPAQUE, TRANSPARENT };
+
+    // A shader with default.vert/default.frag's interface: the instance SSBO, u_Material and the
+    // two samplers.
+    struct Pipeline {
+        const Shader* shader{nullptr};
+        Uniform<uint32_t> u_material{};
+        Uniform<int> u_base_color_texture{}, u_metallic_roughness_texture{};
+    };
+
+    struct Packet {
+        uint64_t key{0};
+        uint32_t first_instance{0}; // into this frame's instance matrices
+        uint32_t instance_count{0};
+        GLuint VAO{0};
+        uint32_t offset{0};
+        uint32_t count{0};
+        int32_t base_vertex{0};
+        GLenum index_type{GL_UNSIGNED_INT};
+        uint32_t material{0}; // MaterialBuffer index
+        int32_t base_color_texture_idx{-1};
+        int32_t metallic_roughness_texture_idx{-1};
+        glm::vec4 base_color{1.0f}; // for the placeholder while the texture is still decoding
+        uint8_t pipeline{0};
+        Pass pass{Pass::OPAQUE};
+        bool double_sided{false};
+    };
+
+    // GL state transitions, by kind.
+    struct StateChanges {
+        uint32_t programs{0};
+        uint32_t vaos{0};
+        uint32_t textures{0};
+        uint32_t materials{0};
+        uint32_t cull{0};
+        uint32_t blend{0};
+
+        [[nodiscard]] uint32_t total() const { return programs + vaos + textures + materials + cull + blend; }
+    };
+
+    struct Stats {
+        uint32_t packets{0}; // = draw calls
+        uint32_t instances{0};
+        uint32_t culled{0}; // instances
+        uint64_t triangles{0}; // over all instances, at the level of detail they were drawn with
+        // what the packets cost in push order, with the same redundancy filtering
+        StateChanges unsorted{};
+        // what submit() issued
+        StateChanges sorted{};
+    };
+
+    static constexpr size_t MAX_PIPELINES = 8;
+
+    // Returns the index to push packets with. 'shader' must outlive the queue.
+    uint8_t add_pipeline(const Shader& shader);
+
+    // Clears the queue. 'view' and 'far_plane' quantize the depth part of the keys.
+    void begin(const glm::mat4& view, float far_plane);
+    // Queues every instance of 'model' that intersects 'frustum', or all of them without one, at the
+    // level of detail 'lod' selects for it, or full detail without one. 'materials' resolves
+    // mat_idx to the buffer index the shaders use.
+    void push(const AssetManager::Model& model, uint8_t pipeline, const MaterialBuffer& materials,
+              const Frustum* frustum = nullptr, const LodSelector* lod = nullptr);
+    void sort();
+    // Draws the sorted packets. The pipelines' shaders must have their per-frame uniforms set
+    // and the MaterialBuffer must be synced. Leaves culling on, blending off and depth writes on.
+    void submit();
+
+    [[nodiscard]] const Stats& stats() const { return frame_stats; }
+
+private:
+    struct SortItem {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    // What submit() last bound, see apply().
+    struct State {
+        int pipeline{-1};
+        GLuint VAO{0};
+        int32_t textures[2]{-1, -1};
+        uint32_t material{UINT32_MAX};
+        bool cull{true};
+        bool blend{false};
+    };
+
+    std::vector<Pipeline> pipelines{};
+    // (base color, metallic/roughness) texture pair -> dense id for the key, rebuilt every frame
+    std::unordered_map<uint64_t, uint32_t> texture_sets{};
+    // GL vertex array name -> dense id for the key, rebuilt every frame
+    std::unordered_map<GLuint, uint32_t> vao_ids{};
+
+    glm::mat4 view{1.0f};
+    float far_plane{1.0f};
+
+    // rebuilt every frame, kept around to reuse their memory
+    std::vector<Packet> packets{};
+    std::vector<SortItem> items{}, scratch{};
+    std::vector<uint8_t> visible{};
+    // visible opaque instances of the primitive being pushed with their level of detail
+    std::vector<std::pair<uint32_t, uint32_t>> opaque_levels{};
+    std::vector<glm::mat4> instance_data{};
+    StreamBuffer instance_buffer{GL_SHADER_STORAGE_BUFFER};
+    Stats frame_stats{};
+
+    uint32_t texture_set(int32_t base_color_texture_idx, int32_t metallic_roughness_texture_idx);
+    uint32_t vao_id(GLuint VAO);
+    // Counts the transitions from 'state' to what 'p' needs into 'changes' and updates 'state'.
+    // Issues the GL calls as well if 'issue' is set.
+    void apply(State& state, const Packet& p, StateChanges& changes, bool issue) const;
+};
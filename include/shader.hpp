@@ -4,17 +4,63 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 
+// FNV-1a, usable at compile time so uniform names can be hashed where they are written.
+constexpr uint64_t uniform_hash(std::string_view name)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (char c : name)
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    return h;
+}
+
+// A uniform name hashed at compile time: shader.uniform<glm::mat4>("u_PV") does no string work at runtime.
+struct UniformName {
+    consteval UniformName(const char* name) : name(name), hash(uniform_hash(name)) {}
+    const char* name;
+    uint64_t hash;
+};
+
+// Typed handle to a uniform location, resolved once. Invalid handles are ignored by Shader::set().
+template <typename T>
+struct Uniform {
+    GLint location{-1};
+    [[nodiscard]] bool valid() const { return location >= 0; }
+};
+
 class Shader
 {
 public:
+    struct UniformStats {
+        uint64_t updates{0}; // glProgramUniform* calls issued
+        uint64_t elided{0};  // sets skipped because the value did not change
+    };
+
     virtual ~Shader();
     void use() const;
 
+    // Looks up a uniform reflected at link time. Logs and returns an invalid handle if the uniform is
+    // not active or its GL type does not match T (int handles also accept bool and sampler uniforms).
+    template <typename T>
+    [[nodiscard]] Uniform<T> uniform(UniformName name) const { return {checked_location(name, gl_type<T>())}; }
+
+    // Every setter keeps a shadow copy of the last value per location and skips the GL call if it is unchanged.
+    void set(Uniform<int> u, int value) const { write(u.location, value); }
+    void set(Uniform<uint32_t> u, uint32_t value) const { write(u.location, value); }
+    void set(Uniform<float> u, float value) const { write(u.location, value); }
+    void set(Uniform<glm::vec2> u, const glm::vec2& value) const { write(u.location, value); }
+    void set(Uniform<glm::vec3> u, const glm::vec3& value) const { write(u.location, value); }
+    void set(Uniform<glm::vec4> u, const glm::vec4& value) const { write(u.location, value); }
+    void set(Uniform<glm::mat4> u, const glm::mat4& value) const { write(u.location, value); }
+
+    // By name, through uniform_location_cache.
     void set_bool(const std::string &name, bool value) const;
     void set_int(const std::string &name, int value) const;
     void set_uint(const std::string &name, uint value) const;
@@ -24,10 +70,54 @@ public:
     void set_vec4(const std::string &name, const glm::vec4 &value) const;
     void set_mat4(const std::string &name, const glm::mat4 &value) const;
 
+    [[nodiscard]] const UniformStats& uniform_stats() const { return stats; }
+    void reset_uniform_stats() const { stats = UniformStats{}; }
+
 protected:
     GLuint ID;
+    // name -> location, filled by reflect_uniforms() after linking
     mutable std::unordered_map<std::string, GLint> uniform_location_cache;
 
     virtual void compile(const std::vector<std::pair<GLenum, std::string>> &sources) = 0;
     void check_compile_error(const GLuint shader, const std::string &&type);
+    // Must be called once the program is linked.
+    void reflect_uniforms();
+
+private:
+    struct ShadowValue {
+        bool valid{false};
+        alignas(16) unsigned char bytes[sizeof(glm::mat4)]{};
+    };
+
+    std::unordered_map<uint64_t, GLint> hashed_locations{};
+    std::unordered_map<GLint, GLenum> location_types{};
+    // indexed by location
+    mutable std::vector<ShadowValue> shadow{};
+    mutable UniformStats stats{};
+
+    template <typename T>
+    static constexpr GLenum gl_type()
+    {
+        if constexpr (std::is_same_v<T, int>) return GL_INT;
+        else if constexpr (std::is_same_v<T, uint32_t>) return GL_UNSIGNED_INT;
+        else if constexpr (std::is_same_v<T, float>) return GL_FLOAT;
+        else if constexpr (std::is_same_v<T, glm::vec2>) return GL_FLOAT_VEC2;
+        else if constexpr (std::is_same_v<T, glm::vec3>) return GL_FLOAT_VEC3;
+        else if constexpr (std::is_same_v<T, glm::vec4>) return GL_FLOAT_VEC4;
+        else if constexpr (std::is_same_v<T, glm::mat4>) return GL_FLOAT_MAT4;
+        else static_assert(sizeof(T) == 0, "Unsupported uniform type.");
+    }
+
+    GLint checked_location(UniformName name, GLenum type) const;
+    GLint location(const std::string& name) const;
+    // True if 'value' differs from the shadow copy, which is then updated.
+    bool changed(GLint location, const void* value, size_t size) const;
+
+    void write(GLint location, int value) const;
+    void write(GLint location, uint32_t value) const;
+    void write(GLint location, float value) const;
+    void write(GLint location, const glm::vec2& value) const;
+    void write(GLint location, const glm::vec3& value) const;
+    void write(GLint location, const glm::vec4& value) const;
+    void write(GLint location, const glm::mat4& value) const;
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Generational slot map. Values live densely packed in one vector so iterating them
+// is linear in memory; handles go through an indirection table and stay valid until
+// the value is erased. Erasing swaps the last value into the hole and bumps the slot's
+// generation so stale handles are rejected. Freed slots are reused by later inserts.
+template <typename T>
+class SlotMap {
+public:
+    struct Handle {
+        uint32_t index{UINT32_MAX};
+        uint32_t generation{0};
+
+        explicit operator bool() const { return index != UINT32_MAX; }
+        bool operator==(const Handle&) const = default;
+    };
+
+    Handle insert(T value)
+    {
+        uint32_t slot_idx;
+        if (!free_slots.empty()) {
+            slot_idx = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot_idx = static_cast<uint32_t>(slots.size());
+            slots.push_back(Slot{});
+        }
+
+        slots[slot_idx].dense_idx = static_cast<uint32_t>(values.size());
+        values.push_back(std::move(value));
+        value_slots.push_back(slot_idx);
+        return Handle{slot_idx, slots[slot_idx].generation};
+    }
+
+    bool erase(Handle h)
+    {
+        if (!contains(h))
+            return false;
+
+        Slot& slot = slots[h.index];
+        const uint32_t last = static_cast<uint32_t>(values.size() - 1);
+        if (slot.dense_idx != last) {
+            values[slot.dense_idx] = std::move(values[last]);
+            value_slots[slot.dense_idx] = value_slots[last];
+            slots[value_slots[last]].dense_idx = slot.dense_idx;
+        }
+        values.pop_back();
+        value_slots.pop_back();
+
+        slot.generation++;
+        free_slots.push_back(h.index);
+        return true;
+    }
+
+    [[nodiscard]] bool contains(Handle h) const
+    {
+        return h.index < slots.size() && slots[h.index].generation == h.generation;
+    }
+
+    // nullptr for stale or invalid handles
+    T* get(Handle h) { return contains(h) ? &values[slots[h.index].dense_idx] : nullptr; }
+    const T* get(Handle h) const { return contains(h) ? &values[slots[h.index].dense_idx] : nullptr; }
+
+    // Handle of the i-th value in iteration order.
+    [[nodiscard]] Handle handle_at(size_t i) const
+    {
+        const uint32_t slot_idx = value_slots[i];
+        return Handle{slot_idx, slots[slot_idx].generation};
+    }
+
+    [[nodiscard]] size_t size() const { return values.size(); }
+    [[nodiscard]] bool empty() const { return values.empty(); }
+
+    auto begin() { return values.begin(); }
+    auto end() { return values.end(); }
+    auto begin() const { return values.begin(); }
+    auto end() const { return values.end(); }
+
+private:
+    struct Slot {
+        uint32_t dense_idx{0};
+        // starts at 1 so a default constructed Handle never matches
+        uint32_t generation{1};
+    };
+
+    std::vector<T> values{};
+    std::vector<uint32_t> value_slots{}; // dense index -> slot
+    std::vector<Slot> slots{};
+    std::vector<uint32_t> free_slots{};
+};
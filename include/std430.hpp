@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "glm/glm.hpp"
+
+// Compile-time std430 layout rules (GLSL 4.60 spec, 7.6.2.2) for the scalar, vector and
+// matrix types we put into storage buffers. Used to static_assert that C++ mirrors of
+// GLSL structs have the offsets the shader expects.
+namespace std430 {
+
+    template <typename T>
+    constexpr size_t alignment()
+    {
+        if constexpr (std::is_same_v<T, float> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t>) return 4;
+        else if constexpr (std::is_same_v<T, glm::vec2>) return 8;
+        else if constexpr (std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::vec4>) return 16;
+        else if constexpr (std::is_same_v<T, glm::mat4>) return 16;
+        else static_assert(sizeof(T) == 0, "No std430 rule for this type.");
+    }
+
+    template <typename T>
+    constexpr size_t size()
+    {
+        if constexpr (std::is_same_v<T, glm::vec3>) return 12;
+        else return sizeof(T);
+    }
+
+    // Offsets of the members of a struct declared with these types, in order.
+    template <typename... Ts>
+    constexpr std::array<size_t, sizeof...(Ts)> offsets()
+    {
+        std::array<size_t, sizeof...(Ts)> out{};
+        size_t offset = 0, i = 0;
+        ((offset = (offset + alignment<Ts>() - 1) / alignment<Ts>() * alignment<Ts>(), out[i++] = offset, offset += size<Ts>()), ...);
+        return out;
+    }
+
+    // Array stride of such a struct: the end of its last member rounded up to its largest member alignment.
+    template <typename... Ts>
+    constexpr size_t struct_size()
+    {
+        constexpr size_t align = std::max({alignment<Ts>()...});
+        constexpr size_t sizes[] = {size<Ts>()...};
+        constexpr size_t end = offsets<Ts...>().back() + sizes[sizeof...(Ts) - 1];
+        return (end + align - 1) / align * align;
+    }
+
+}; // end namespace 'std430'
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "glad.h"
+
+#include <cstddef>
+
+// GL buffer whose contents are replaced every frame. It grows geometrically and never shrinks,
+// so a slowly growing scene does not reallocate it every frame.
+class StreamBuffer {
+public:
+    explicit StreamBuffer(GLenum target);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Replaces the contents with 'size' bytes of 'data' and leaves the buffer bound to its target.
+    void upload(const void* data, size_t size);
+    [[nodiscard]] GLuint id() const { return ID; }
+
+private:
+    GLuint ID{0};
+    GLenum target{0};
+    size_t capacity{0};
+};
@@ -2,6 +2,11 @@
 
 #include "glad.h"
 
+#include <atomic>
+#include <memory>
+#include <span>
+#include <vector>
+
 struct Texture {
 
     struct TextureConfig {
@@ -18,12 +23,31 @@ struct Texture {
         uint32_t width{0}, height{0};
     };
 
+    // Compressed image of a lazy texture, decoded on the job system on first use.
+    struct PendingImage {
+        enum class State { COMPRESSED, DECODING, DECODED, FAILED };
+
+        std::atomic<State> state{State::COMPRESSED};
+        TextureConfig conf{};
+        std::vector<unsigned char> compressed{};
+        std::vector<unsigned char> pixels{};
+    };
+
     Texture() = default;
     ~Texture() { /*if (ID) glDeleteTextures(1, &ID);*/ }
 
     // ^^^^^^^^^^^^^^^^^^^^^^^^^^^^^ DON'T FORGET ABOUT THIS
 
     bool create_texture(const TextureConfig& conf, const unsigned char* data);
+    // Keeps only the compressed image (and the sampler state in 'conf'); nothing is decoded
+    // or uploaded until the first acquire().
+    void create_lazy(const TextureConfig& conf, std::span<const unsigned char> compressed);
+    // Decodes the compressed image on the calling thread and uploads it, using the sampler state in 'conf'.
+    bool create_decoded(const TextureConfig& conf, std::span<const unsigned char> compressed);
+    // GL texture to bind. Lazy textures return 0 while their image is still decoding.
+    // Must be called on the GL context thread.
+    uint32_t acquire();
 
     uint32_t ID{0};
+    std::shared_ptr<PendingImage> pending{};
 };
\ No newline at end of file
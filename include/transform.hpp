@@ -0,0 +1,66 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Writes parent * T * R * S for every element, the same matrix get_node_transform() builds for
+// a node. Rotations are unit quaternions stored (x, y, z, w) as in glTF. Batches of 4 are
+// converted in SSE registers with one element per lane.
+void compose_trs(const glm::mat4& parent, const glm::vec3* translations, const glm::vec4* rotations,
+                 const glm::vec3* scales, size_t count, glm::mat4* out);
+
+// Node transforms of a scene graph as flat arrays in depth-first pre-order: parents come before
+// their children and the subtree of node i is the contiguous range [i, subtree_end[i]).
+// Editing a node only marks it dirty. update() then recomputes the world matrices of the dirty
+// subtrees in one linear pass over each, splitting large ones across the job system.
+struct TransformHierarchy {
+    static constexpr int32_t NO_PARENT = -1;
+
+    std::vector<int32_t> parent{};
+    std::vector<uint32_t> subtree_end{};
+    // what the local matrix was built from, identity for nodes given as a matrix
+    std::vector<glm::vec3> translation{};
+    std::vector<glm::vec4> rotation{}; // (x, y, z, w)
+    std::vector<glm::vec3> scale{};
+    std::vector<glm::mat4> local{};
+    std::vector<glm::mat4> world{};
+    // local changed since the last update()
+    std::vector<uint8_t> dirty{};
+    // world changed by the last update()
+    std::vector<uint8_t> changed{};
+
+    [[nodiscard]] size_t size() const { return parent.size(); }
+
+    // Appends a node below 'parent_idx' (NO_PARENT for roots). Nodes must be added in pre-order,
+    // then finalize() once. Returns the node's index.
+    uint32_t add(int32_t parent_idx, const glm::vec3& t, const glm::vec4& r, const glm::vec3& s);
+    uint32_t add(int32_t parent_idx, const glm::mat4& local_matrix);
+    // Computes the subtree ranges and marks every node dirty.
+    void finalize();
+
+    void set_trs(uint32_t node, const glm::vec3& t, const glm::vec4& r, const glm::vec3& s);
+    void set_local(uint32_t node, const glm::mat4& local_matrix);
+
+    // Recomputes world for every dirty node and its descendants and sets 'changed' for exactly
+    // those. Returns how many world matrices were recomputed.
+    uint32_t update();
+
+private:
+    struct Range {
+        uint32_t begin, end;
+    };
+
+    bool any_dirty{false};
+    // rebuilt by every update(), kept around to reuse their memory
+    std::vector<Range> updated{}, work{};
+    std::vector<uint32_t> heads{};
+
+    void split(Range range, uint32_t grain);
+    void refresh(uint32_t node);
+};
+
+// Dirty nodes below this many are updated on the calling thread.
+constexpr size_t PARALLEL_TRANSFORM_THRESHOLD = 8192;
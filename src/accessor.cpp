@@ -0,0 +1,407 @@
+#include "accessor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ACCESSOR_X86
+#include <immintrin.h>
+#endif
+
+namespace accessor {
+
+    template <typename T>
+    static inline T load(const unsigned char* p)
+    {
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        return v;
+    }
+
+    static size_t matrix_rows(int num_components)
+    {
+        switch (num_components) {
+            case 4: return 2;
+            case 9: return 3;
+            case 16: return 4;
+            default: return 0;
+        }
+    }
+
+    static size_t element_size(const View& v)
+    {
+        if (v.column_size != 0)
+            return v.column_size * matrix_rows(v.num_components);
+        return v.num_components * tinygltf::GetComponentSizeInBytes(v.component_type);
+    }
+
+    // Byte offset of component 'c' inside one element; matrix columns are 4-byte aligned.
+    static size_t component_offset(const View& v, size_t c)
+    {
+        const size_t comp_size = tinygltf::GetComponentSizeInBytes(v.component_type);
+        if (v.column_size == 0)
+            return c * comp_size;
+        const size_t rows = matrix_rows(v.num_components);
+        return (c / rows) * v.column_size + (c % rows) * comp_size;
+    }
+
+    static float read_component(const unsigned char* p, int component_type, bool normalized)
+    {
+        switch (component_type) {
+            case TINYGLTF_COMPONENT_TYPE_BYTE: {
+                const float c = load<int8_t>(p);
+                return normalized ? std::max(c / 127.0f, -1.0f) : c;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+                const float c = load<uint8_t>(p);
+                return normalized ? c / 255.0f : c;
+            }
+            case TINYGLTF_COMPONENT_TYPE_SHORT: {
+                const float c = load<int16_t>(p);
+                return normalized ? std::max(c / 32767.0f, -1.0f) : c;
+            }
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+                const float c = load<uint16_t>(p);
+                return normalized ? c / 65535.0f : c;
+            }
+            case TINYGLTF_COMPONENT_TYPE_INT:
+                return static_cast<float>(load<int32_t>(p));
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+                return static_cast<float>(load<uint32_t>(p));
+            case TINYGLTF_COMPONENT_TYPE_FLOAT:
+                return load<float>(p);
+            case TINYGLTF_COMPONENT_TYPE_DOUBLE:
+                return static_cast<float>(load<double>(p));
+            default:
+                return 0.0f;
+        }
+    }
+
+    static uint32_t read_index(const unsigned char* p, int component_type)
+    {
+        switch (component_type) {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return load<uint8_t>(p);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return load<uint16_t>(p);
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: return load<uint32_t>(p);
+            default: return 0;
+        }
+    }
+
+    static void read_element(const View& v, const unsigned char* elem, float* out)
+    {
+        for (int c = 0; c < v.num_components; c++)
+            out[c] = read_component(elem + component_offset(v, c), v.component_type, v.normalized);
+    }
+
+    // Calls write(target_index, value_ptr) for every sparse substitution.
+    template <typename F>
+    static void for_each_sparse(const View& v, F&& write)
+    {
+        const size_t index_size = tinygltf::GetComponentSizeInBytes(v.sparse.index_component_type);
+        const size_t value_size = element_size(v);
+        for (size_t i = 0; i < v.sparse.count; i++) {
+            const size_t target = read_index(v.sparse.indices + i * index_size, v.sparse.index_component_type);
+            if (target < v.count)
+                write(target, v.sparse.values + i * value_size);
+        }
+    }
+
+    /*
+     * SIMD kernels
+     */
+
+#ifdef ACCESSOR_X86
+    static bool has_avx2()
+    {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+    }
+
+    // Strided float3 -> packed float3. Each 16-byte store spills one float into the
+    // next element, so the last element is copied separately.
+    static void strided_float3_sse(const unsigned char* src, size_t count, size_t stride, float* out)
+    {
+        for (size_t i = 0; i + 1 < count; i++)
+            _mm_storeu_ps(out + i * 3, _mm_loadu_ps(reinterpret_cast<const float*>(src + i * stride)));
+        std::memcpy(out + (count - 1) * 3, src + (count - 1) * stride, 3 * sizeof(float));
+    }
+
+    // Interleaved {float3 pos, float3 norm, float2 tc} with a 32-byte stride.
+    __attribute__((target("avx2")))
+    static void deinterleave_pnt_avx2(const unsigned char* src, size_t count, float* pos, float* norm, float* tc)
+    {
+        for (size_t i = 0; i + 1 < count; i++) {
+            const __m256 v = _mm256_loadu_ps(reinterpret_cast<const float*>(src + i * 32));
+            const __m128 lo = _mm256_castps256_ps128(v);   // p.x p.y p.z n.x
+            const __m128 hi = _mm256_extractf128_ps(v, 1); // n.y n.z t.x t.y
+            const __m128 n = _mm_castsi128_ps(_mm_alignr_epi8(_mm_castps_si128(hi), _mm_castps_si128(lo), 12));
+            _mm_storeu_ps(pos + i * 3, lo);
+            _mm_storeu_ps(norm + i * 3, n);
+            _mm_storeh_pi(reinterpret_cast<__m64*>(tc + i * 2), hi);
+        }
+        const size_t last = count - 1;
+        std::memcpy(pos + last * 3, src + last * 32, 3 * sizeof(float));
+        std::memcpy(norm + last * 3, src + last * 32 + 12, 3 * sizeof(float));
+        std::memcpy(tc + last * 2, src + last * 32 + 24, 2 * sizeof(float));
+    }
+
+    __attribute__((target("avx2")))
+    static size_t widen_u8_avx2(const unsigned char* src, size_t count, uint32_t base, uint32_t* out)
+    {
+        const __m256i vbase = _mm256_set1_epi32(base);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(v, vbase));
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2")))
+    static size_t widen_u16_avx2(const unsigned char* src, size_t count, uint32_t base, uint32_t* out)
+    {
+        const __m256i vbase = _mm256_set1_epi32(base);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi32(v, vbase));
+        }
+        return i;
+    }
+
+    static size_t widen_u8_sse2(const unsigned char* src, size_t count, uint32_t base, uint32_t* out)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vbase = _mm_set1_epi32(base);
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero);
+            const __m128i hi = _mm_unpackhi_epi8(v, zero);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 0), _mm_add_epi32(_mm_unpacklo_epi16(lo, zero), vbase));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_add_epi32(_mm_unpackhi_epi16(lo, zero), vbase));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_add_epi32(_mm_unpacklo_epi16(hi, zero), vbase));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_add_epi32(_mm_unpackhi_epi16(hi, zero), vbase));
+        }
+        return i;
+    }
+
+    static size_t widen_u16_sse2(const unsigned char* src, size_t count, uint32_t base, uint32_t* out)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vbase = _mm_set1_epi32(base);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 0), _mm_add_epi32(_mm_unpacklo_epi16(v, zero), vbase));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_add_epi32(_mm_unpackhi_epi16(v, zero), vbase));
+        }
+        return i;
+    }
+#endif
+
+    /*
+     * Public API
+     */
+
+    bool make_view(const tinygltf::Model& model, const BufferSpans& buffers, const tinygltf::Accessor& acc, View& out)
+    {
+        const int comp_size = tinygltf::GetComponentSizeInBytes(acc.componentType);
+        const int num_components = tinygltf::GetNumComponentsInType(acc.type);
+        if (comp_size <= 0 || num_components <= 0) {
+            printf("Accessor '%s' has unsupported type %d / componentType %d.\n",
+                acc.name.c_str(), acc.type, acc.componentType);
+            return false;
+        }
+
+        View v{};
+        v.count = acc.count;
+        v.component_type = acc.componentType;
+        v.num_components = num_components;
+        v.normalized = acc.normalized;
+        if (acc.type == TINYGLTF_TYPE_MAT2 || acc.type == TINYGLTF_TYPE_MAT3 || acc.type == TINYGLTF_TYPE_MAT4)
+            v.column_size = static_cast<int>((matrix_rows(num_components) * comp_size + 3) & ~size_t{3});
+        const size_t elem_size = element_size(v);
+
+        // Returns a pointer to 'size' bytes at 'offset' into the given bufferView, or nullptr if out of bounds.
+        const auto resolve = [&](int bv_idx, size_t offset, size_t size) -> const unsigned char* {
+            if (bv_idx < 0 || static_cast<size_t>(bv_idx) >= model.bufferViews.size())
+                return nullptr;
+            const auto& bv = model.bufferViews[bv_idx];
+            if (bv.buffer < 0 || static_cast<size_t>(bv.buffer) >= buffers.size())
+                return nullptr;
+            const auto& buffer = buffers[bv.buffer];
+            if (bv.byteOffset + bv.byteLength > buffer.size() || offset + size > bv.byteLength)
+                return nullptr;
+            return buffer.data() + bv.byteOffset + offset;
+        };
+
+        v.stride = elem_size;
+        if (acc.bufferView >= 0) {
+            if (acc.bufferView < static_cast<int>(model.bufferViews.size()) && model.bufferViews[acc.bufferView].byteStride != 0)
+                v.stride = model.bufferViews[acc.bufferView].byteStride;
+            const size_t needed = acc.count == 0 ? 0 : (acc.count - 1) * v.stride + elem_size;
+            v.data = resolve(acc.bufferView, acc.byteOffset, needed);
+            if (v.data == nullptr) {
+                printf("Accessor '%s' is out of bounds of its bufferView.\n", acc.name.c_str());
+                return false;
+            }
+        }
+
+        if (acc.sparse.isSparse && acc.sparse.count > 0) {
+            const int index_size = tinygltf::GetComponentSizeInBytes(acc.sparse.indices.componentType);
+            if (index_size <= 0) {
+                printf("Accessor '%s' has unsupported sparse index type.\n", acc.name.c_str());
+                return false;
+            }
+            v.sparse.count = acc.sparse.count;
+            v.sparse.index_component_type = acc.sparse.indices.componentType;
+            v.sparse.indices = resolve(acc.sparse.indices.bufferView, acc.sparse.indices.byteOffset, v.sparse.count * index_size);
+            v.sparse.values = resolve(acc.sparse.values.bufferView, acc.sparse.values.byteOffset, v.sparse.count * elem_size);
+            if (v.sparse.indices == nullptr || v.sparse.values == nullptr) {
+                printf("Accessor '%s' has out of bounds sparse data.\n", acc.name.c_str());
+                return false;
+            }
+        }
+
+        out = v;
+        return true;
+    }
+
+    bool read_floats(const View& view, float* out)
+    {
+        const size_t n = view.num_components;
+
+        if (view.data == nullptr) {
+            std::fill(out, out + view.count * n, 0.0f);
+        } else if (view.component_type == TINYGLTF_COMPONENT_TYPE_FLOAT && view.column_size == 0) {
+            if (view.stride == n * sizeof(float)) {
+                std::memcpy(out, view.data, view.count * view.stride);
+            }
+#ifdef ACCESSOR_X86
+            else if (n == 3 && view.count > 0) {
+                strided_float3_sse(view.data, view.count, view.stride, out);
+            }
+#endif
+            else {
+                for (size_t i = 0; i < view.count; i++)
+                    std::memcpy(out + i * n, view.data + i * view.stride, n * sizeof(float));
+            }
+        } else {
+            for (size_t i = 0; i < view.count; i++)
+                read_element(view, view.data + i * view.stride, out + i * n);
+        }
+
+        if (view.sparse.count > 0) {
+            for_each_sparse(view, [&](size_t target, const unsigned char* value) {
+                read_element(view, value, out + target * n);
+            });
+        }
+
+        return true;
+    }
+
+    bool read_vec2(const View& view, glm::vec2* out)
+    {
+        if (view.num_components != 2) {
+            printf("Expected a VEC2 accessor, got %d components.\n", view.num_components);
+            return false;
+        }
+        return read_floats(view, &out[0].x);
+    }
+
+    bool read_vec3(const View& view, glm::vec3* out)
+    {
+        if (view.num_components != 3) {
+            printf("Expected a VEC3 accessor, got %d components.\n", view.num_components);
+            return false;
+        }
+        return read_floats(view, &out[0].x);
+    }
+
+    bool read_vec4(const View& view, glm::vec4* out)
+    {
+        if (view.num_components != 4 || view.column_size != 0) {
+            printf("Expected a VEC4 accessor, got %d components.\n", view.num_components);
+            return false;
+        }
+        return read_floats(view, &out[0].x);
+    }
+
+    bool read_vertices(const View& pos, const View* norm, const View* tc,
+                       glm::vec3* out_pos, glm::vec3* out_norm, glm::vec2* out_tc)
+    {
+        if ((norm && norm->count != pos.count) || (tc && tc->count != pos.count)) {
+            printf("Vertex attributes have mismatching counts.\n");
+            return false;
+        }
+
+#ifdef ACCESSOR_X86
+        const auto is_plain_float = [](const View& v, int n) {
+            return v.data != nullptr && v.component_type == TINYGLTF_COMPONENT_TYPE_FLOAT &&
+                   v.num_components == n && v.stride == 32 && v.sparse.count == 0;
+        };
+        if (norm && tc && out_norm && out_tc && pos.count > 0 && has_avx2() &&
+            is_plain_float(pos, 3) && is_plain_float(*norm, 3) && is_plain_float(*tc, 2) &&
+            norm->data == pos.data + 12 && tc->data == pos.data + 24) {
+            deinterleave_pnt_avx2(pos.data, pos.count, &out_pos[0].x, &out_norm[0].x, &out_tc[0].x);
+            return true;
+        }
+#endif
+
+        if (!read_vec3(pos, out_pos))
+            return false;
+        if (norm && out_norm && !read_vec3(*norm, out_norm))
+            return false;
+        if (tc && out_tc && !read_vec2(*tc, out_tc))
+            return false;
+        return true;
+    }
+
+    bool read_indices(const View& view, uint32_t base_vertex, uint32_t* out)
+    {
+        const int type = view.component_type;
+        if (view.num_components != 1 ||
+            (type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+             type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+             type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)) {
+            printf("Unsupported index component type %d\n", type);
+            return false;
+        }
+
+        const size_t comp_size = tinygltf::GetComponentSizeInBytes(type);
+        size_t i = 0;
+
+        if (view.data == nullptr) {
+            std::fill(out, out + view.count, base_vertex);
+            i = view.count;
+        }
+#ifdef ACCESSOR_X86
+        else if (view.stride == comp_size && type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+            i = has_avx2() ? widen_u8_avx2(view.data, view.count, base_vertex, out)
+                           : widen_u8_sse2(view.data, view.count, base_vertex, out);
+        } else if (view.stride == comp_size && type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
+            i = has_avx2() ? widen_u16_avx2(view.data, view.count, base_vertex, out)
+                           : widen_u16_sse2(view.data, view.count, base_vertex, out);
+        }
+#endif
+        else if (view.stride == comp_size && type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT && base_vertex == 0) {
+            std::memcpy(out, view.data, view.count * sizeof(uint32_t));
+            i = view.count;
+        }
+
+        // scalar tail / generic strided path
+        for (; i < view.count; i++)
+            out[i] = read_index(view.data + i * view.stride, type) + base_vertex;
+
+        if (view.sparse.count > 0) {
+            for_each_sparse(view, [&](size_t target, const unsigned char* value) {
+                out[target] = read_index(value, type) + base_vertex;
+            });
+        }
+
+        return true;
+    }
+
+}; // end namespace 'accessor'
@@ -1,42 +1,391 @@
 #include "asset_manager.hpp"
+#include "accessor.hpp"
+#include "hash.hpp"
+#include "job_system.hpp"
+#include "mapped_file.hpp"
+#include "mesh_optimizer.hpp"
+#include "model_cache.hpp"
+#include "transform.hpp"
 
 #include "glad.h"
+#include "json.hpp"
 
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
 
+#include <algorithm>
 #include <assert.h>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <numeric>
 #include <stack>
+#include <string_view>
 
 namespace AssetManager {
 
-    std::unordered_map<std::string, Model> models{};
+    SlotMap<Model> models{};
     std::vector<Material> materials{};
     std::vector<Texture> textures{};
 
-    bool load_model(const std::string name, const FILE_FORMAT format)
+    static std::unordered_map<std::string, ModelHandle> model_names{};
+    static std::unordered_map<uint64_t, int32_t> texture_cache{};
+
+    ModelHandle load_model(const std::string name, const FILE_FORMAT format, const LoadOptions& options)
     {
         switch (format) {
             case FILE_FORMAT::GLB:
-                return load_glb(name);
+                return load_glb(name, options);
             default:
                 printf("Unsupported fileformat.");
                 break;
         }
-        return false;
+        return {};
+    }
+
+    bool unload_model(ModelHandle handle)
+    {
+        Model* m = models.get(handle);
+        if (m == nullptr)
+            return false;
+
+        destroy_geometry(m->geometry);
+        model_names.erase(m->name);
+        return models.erase(handle);
+    }
+
+    ModelHandle find_model(const std::string& name)
+    {
+        const auto it = model_names.find(name);
+        return it != model_names.end() && models.contains(it->second) ? it->second : ModelHandle{};
+    }
+
+    // tinygltf image loader that decodes right away like the default one, accounting the time to IMAGE_DECODE.
+    static bool decode_image_tracked(tinygltf::Image* image, const int image_idx, std::string* err, std::string* warn,
+                                     int req_width, int req_height, const unsigned char* bytes, int size, void* user_data)
+    {
+        auto* tracker = static_cast<LoadTracker*>(user_data);
+        tracker->begin(LoadStage::IMAGE_DECODE);
+        const bool ok = tinygltf::LoadImageData(image, image_idx, err, warn, req_width, req_height, bytes, size, nullptr);
+        tracker->end(LoadStage::IMAGE_DECODE, static_cast<uint64_t>(size));
+        return ok;
     }
 
-    bool load_glb(const std::string &name)
+    // Length of the JSON chunk of a .glb, 0 if the header is not readable.
+    static uint64_t glb_json_length(std::span<const unsigned char> glb)
+    {
+        uint32_t length = 0;
+        if (glb.size() >= 20)
+            std::memcpy(&length, glb.data() + 12, sizeof(length));
+        return length;
+    }
+
+    static bool read_file(const std::filesystem::path& path, std::vector<unsigned char>& out)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        out.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(out.data()), out.size()));
+    }
+
+    // End of the JSON value starting at 'pos' (after leading whitespace), npos if it is cut off.
+    // Only tracks strings and nesting, the value itself is validated by whoever parses it.
+    static size_t skip_json_value(std::string_view text, size_t pos)
+    {
+        int depth = 0;
+        bool in_string = false;
+        for (; pos < text.size(); pos++) {
+            const char c = text[pos];
+            if (in_string) {
+                if (c == '\\')
+                    pos++;
+                else if (c == '"')
+                    in_string = false;
+                if (!in_string && depth == 0)
+                    return pos + 1;
+                continue;
+            }
+            if (c == '"') {
+                in_string = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0)
+                    return pos;
+                if (--depth == 0)
+                    return pos + 1;
+            } else if (depth == 0 && (c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+                return pos;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    // Copies the top-level object 'json' into 'rest' without its "buffers" and "images" members,
+    // whose values are returned as text. A scan instead of a parse, tinygltf parses 'rest' anyway.
+    static bool split_glb_json(std::string_view json, std::string& rest, std::string_view& buffers, std::string_view& images)
+    {
+        const auto skip_space = [&](size_t pos) {
+            while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r'))
+                pos++;
+            return pos;
+        };
+
+        size_t pos = skip_space(0);
+        if (pos == json.size() || json[pos] != '{')
+            return false;
+        rest.reserve(json.size());
+        rest = "{";
+        pos = skip_space(pos + 1);
+        while (pos < json.size() && json[pos] != '}') {
+            const size_t member = pos;
+            const size_t key_end = skip_json_value(json, pos);
+            if (json[pos] != '"' || key_end == std::string_view::npos)
+                return false;
+            const std::string_view key = json.substr(pos + 1, key_end - pos - 2);
+            pos = skip_space(key_end);
+            if (pos == json.size() || json[pos] != ':')
+                return false;
+            const size_t value = skip_space(pos + 1);
+            const size_t value_end = skip_json_value(json, value);
+            if (value_end == std::string_view::npos || value_end == value)
+                return false;
+
+            if (key == "buffers") {
+                buffers = json.substr(value, value_end - value);
+            } else if (key == "images") {
+                images = json.substr(value, value_end - value);
+            } else {
+                if (rest.size() > 1)
+                    rest += ',';
+                rest.append(json.substr(member, value_end - member));
+            }
+
+            pos = skip_space(value_end);
+            if (pos < json.size() && json[pos] == ',')
+                pos = skip_space(pos + 1);
+        }
+        if (pos == json.size())
+            return false;
+        rest += '}';
+        return true;
+    }
+
+    // Parses a memory mapped .glb without copying its BIN chunk. Only the JSON chunk is
+    // handed to tinygltf (with 'buffers' and 'images' stripped), buffers become spans into
+    // the mapping and embedded images are decoded straight from the mapped bytes.
+    // Returns false with an empty 'err' if the file is valid but not self-contained.
+    static bool parse_glb_mapped(
+        const MappedFile& file,
+        const std::filesystem::path& base_dir,
+        bool defer_images,
+        LoadTracker& tracker,
+        tinygltf::Model& model,
+        BufferSpans& buffers,
+        std::string& err,
+        std::string& warn
+    ) {
+        constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+        constexpr uint32_t CHUNK_JSON = 0x4E4F534A;
+        constexpr uint32_t CHUNK_BIN = 0x004E4942;
+
+        const auto read_u32 = [&](size_t offset) -> uint32_t {
+            uint32_t v;
+            std::memcpy(&v, file.data() + offset, sizeof(v));
+            return v;
+        };
+
+        if (file.size() < 20 || read_u32(0) != GLB_MAGIC || read_u32(4) != 2) {
+            err = "Not a glTF 2.0 binary.";
+            return false;
+        }
+
+        const size_t length = read_u32(8);
+        const size_t json_length = read_u32(12);
+        if (length > file.size() || 20 + json_length > length || read_u32(16) != CHUNK_JSON) {
+            err = "Invalid glTF binary header.";
+            return false;
+        }
+
+        std::span<const unsigned char> bin{};
+        const size_t bin_header = 20 + json_length;
+        if (bin_header + 8 <= length && read_u32(bin_header + 4) == CHUNK_BIN) {
+            const size_t bin_length = read_u32(bin_header);
+            if (bin_header + 8 + bin_length > length) {
+                err = "BIN chunk exceeds the GLB size.";
+                return false;
+            }
+            bin = file.bytes().subspan(bin_header + 8, bin_length);
+        }
+
+        // only the small "buffers" and "images" arrays are parsed here, the rest goes to tinygltf as is
+        const std::string_view json(reinterpret_cast<const char*>(file.data()) + 20, json_length);
+        std::string stripped{};
+        std::string_view buffers_text{}, images_text{};
+        if (!split_glb_json(json, stripped, buffers_text, images_text)) {
+            err = "Failed to parse JSON chunk.";
+            return false;
+        }
+        const auto parse_array = [](std::string_view text) {
+            return text.empty() ? nlohmann::json::array() : nlohmann::json::parse(text.begin(), text.end(), nullptr, false);
+        };
+        const auto buffers_json = parse_array(buffers_text);
+        const auto images_json = parse_array(images_text);
+        if (!buffers_json.is_array() || !images_json.is_array()) {
+            err = "Failed to parse JSON chunk.";
+            return false;
+        }
+        for (const auto& b : buffers_json) {
+            if (!b.is_object() || b.contains("uri"))
+                return false;
+        }
+        for (const auto& img : images_json) {
+            if (!img.is_object() || img.contains("uri") || !img.contains("bufferView"))
+                return false;
+        }
+
+        tinygltf::TinyGLTF loader;
+        if (!loader.LoadASCIIFromString(&model, &err, &warn, stripped.c_str(),
+                                        static_cast<unsigned int>(stripped.size()), base_dir.string())) {
+            return false;
+        }
+
+        for (const auto& b : buffers_json) {
+            const size_t byte_length = b.value("byteLength", size_t{0});
+            if (byte_length > bin.size()) {
+                err = "Buffer byteLength exceeds the BIN chunk.";
+                return false;
+            }
+            tinygltf::Buffer buffer{};
+            buffer.name = b.value("name", "");
+            model.buffers.push_back(std::move(buffer));
+            buffers.push_back(bin.subspan(0, byte_length));
+        }
+
+        for (size_t i = 0; i < images_json.size(); i++) {
+            const auto& img = images_json[i];
+            tinygltf::Image image{};
+            image.name = img.value("name", "");
+            image.mimeType = img.value("mimeType", "");
+            image.bufferView = img.value("bufferView", -1);
+
+            if (image.bufferView < 0 || static_cast<size_t>(image.bufferView) >= model.bufferViews.size()) {
+                err = "Image references an invalid bufferView.";
+                return false;
+            }
+            const auto& bv = model.bufferViews[image.bufferView];
+            if (static_cast<size_t>(bv.buffer) >= buffers.size() || bv.byteOffset + bv.byteLength > buffers[bv.buffer].size()) {
+                err = "Image bufferView is out of bounds of its buffer.";
+                return false;
+            }
+
+            // deferred images are decoded later straight from their bufferView
+            if (!defer_images && !decode_image_tracked(&image, static_cast<int>(i), &err, &warn, 0, 0,
+                                         buffers[bv.buffer].data() + bv.byteOffset,
+                                         static_cast<int>(bv.byteLength), &tracker)) {
+                return false;
+            }
+            model.images.push_back(std::move(image));
+        }
+
+        return true;
+    }
+
+    ModelHandle load_glb(const std::string &name, const LoadOptions& options)
     {
         const auto path_model = path_models / name;
+        const auto path_cache = cache_path(path_model);
+
+        if (const ModelHandle existing = find_model(name)) {
+            printf("Model '%s' is already loaded.\n", name.c_str());
+            return existing;
+        }
+
+        // registered up front so the cache and the loaders below fill the same slot
+        const ModelHandle handle = models.insert(Model{.name = name});
+        model_names[name] = handle;
+        const auto fail = [&] {
+            unload_model(handle);
+            return ModelHandle{};
+        };
+
+        LoadTracker tracker(options.stats, &options.progress);
+        std::error_code ec;
+        tracker.set_total(std::filesystem::file_size(path_model, ec));
+
+        uint64_t cache_key = 0;
+        if (options.use_cache && compute_cache_key(path_model, options, cache_key)) {
+            if (load_cached_model(*models.get(handle), path_cache, cache_key)) {
+                update_transforms(*models.get(handle));
+                tracker.finish(true);
+                return handle;
+            }
+        }
 
         tinygltf::Model model;
-        tinygltf::TinyGLTF loader;
+        BufferSpans buffers{};
+        MappedFile file{};
         std::string err;
         std::string warn;
-    
-        bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, path_model);
+
+        // images are decoded by us later on (in parallel or on first use), not by tinygltf
+        const bool defer_images = options.parallel_images || options.lazy_textures;
+
+        bool ret = false;
+        bool mapped = false;
+        uint64_t json_bytes = 0;
+        if (options.memory_map) {
+            tracker.begin(LoadStage::FILE_READ);
+            const bool opened = file.open(path_model);
+            tracker.end(LoadStage::FILE_READ, file.size());
+
+            if (opened) {
+                const double image_ms = tracker.stage_ms(LoadStage::IMAGE_DECODE);
+                tracker.begin(LoadStage::JSON_PARSE);
+                ret = parse_glb_mapped(file, path_model.parent_path(), defer_images, tracker, model, buffers, err, warn);
+                json_bytes = glb_json_length(file.bytes());
+                tracker.end(LoadStage::JSON_PARSE, json_bytes, tracker.stage_ms(LoadStage::IMAGE_DECODE) - image_ms);
+                mapped = ret || !err.empty();
+                if (!mapped) {
+                    printf("'%s' is not self-contained, falling back to regular loader.\n", name.c_str());
+                    model = tinygltf::Model{};
+                    buffers.clear();
+                    file.close();
+                }
+            }
+        }
+
+        if (!mapped) {
+            std::vector<unsigned char> contents{};
+            tracker.begin(LoadStage::FILE_READ);
+            const bool read = read_file(path_model, contents);
+            tracker.end(LoadStage::FILE_READ, contents.size());
+
+            tinygltf::TinyGLTF loader;
+            if (defer_images)
+                loader.SetImageLoader(capture_image_bytes, nullptr);
+            else
+                loader.SetImageLoader(decode_image_tracked, &tracker);
+
+            const double image_ms = tracker.stage_ms(LoadStage::IMAGE_DECODE);
+            tracker.begin(LoadStage::JSON_PARSE);
+            if (read) {
+                ret = loader.LoadBinaryFromMemory(&model, &err, &warn, contents.data(),
+                                                  static_cast<unsigned int>(contents.size()), path_model.parent_path().string());
+            } else {
+                err = "Failed to read '" + path_model.string() + "'.";
+            }
+            json_bytes = glb_json_length(contents);
+            tracker.end(LoadStage::JSON_PARSE, json_bytes, tracker.stage_ms(LoadStage::IMAGE_DECODE) - image_ms);
+
+            for (const auto& buffer : model.buffers)
+                buffers.emplace_back(buffer.data);
+        }
     
         if (!warn.empty())
             printf("Warn: %s\n", warn.c_str());
@@ -46,291 +395,1058 @@ namespace AssetManager {
     
         if (!ret) {
             printf("Failed to parse glTF (glb).\n");
-            return false;
+            return fail();
+        }
+        tracker.advance(LoadStage::JSON_PARSE, json_bytes);
+
+        // declared after 'model' so pending decode jobs are drained before it goes away
+        ImageBatch images{};
+        images.report = options.report_image_timings;
+        TexturePlan texture_plan = plan_textures(model, buffers);
+        const bool parallel_images = options.parallel_images && !options.lazy_textures;
+        if (parallel_images) {
+            tracker.begin(LoadStage::IMAGE_DECODE);
+            start_image_decode(model, buffers, images, &texture_plan.decode_image);
         }
 
-        models.emplace(name, Model{});
+        // everything this load appends to the material array starts here
+        const size_t material_base = materials.size();
+        BakedModel bake{};
+        BakedModel* baking = options.use_cache ? &bake : nullptr;
 
-        if (!load_glb_meshes(models[name], model)) {
+        Model& m = *models.get(handle);
+
+        if (!load_glb_meshes(m, model, buffers, baking, &tracker, options)) {
             printf("Failed to load model meshes.\n");
-            return false;
+            return fail();
+        }
+
+        std::vector<int32_t> texture_table{};
+        if (!load_glb_textures(model, buffers, options, parallel_images ? &images : nullptr, texture_plan, texture_table,
+                               baking, &tracker)) {
+            printf("Failed to load model textures.\n");
+            return fail();
         }
 
-        if (!load_glb_materials(models[name], model)) {
+        if (!load_glb_materials(m, model, texture_table)) {
             printf("Failed to load model materials.\n");
-            return false;
+            return fail();
         }
 
-        if (!load_glb_transformations(models[name], model)) {
+        tracker.begin(LoadStage::TRANSFORM_BUILD);
+        const bool transformed = load_glb_transformations(m, model, buffers, options.scene);
+        if (transformed)
+            update_transforms(m);
+        tracker.end(LoadStage::TRANSFORM_BUILD);
+        if (!transformed) {
             printf("Failed to load transformations.\n");
+            return fail();
+        }
+
+        if (baking && !write_cached_model(m, path_cache, cache_key, bake, material_base))
+            printf("Failed to write model cache '%s'.\n", path_cache.c_str());
+
+        tracker.finish(false);
+        return handle;
+    }
+
+    // Bytes of the accessor as stored in the source file, for progress reporting.
+    static uint64_t accessor_bytes(const tinygltf::Model& model, int acc_idx)
+    {
+        if (acc_idx < 0 || static_cast<size_t>(acc_idx) >= model.accessors.size())
+            return 0;
+        const auto& acc = model.accessors[acc_idx];
+        const int comp_size = tinygltf::GetComponentSizeInBytes(acc.componentType);
+        const int num_components = tinygltf::GetNumComponentsInType(acc.type);
+        return comp_size > 0 && num_components > 0 ? uint64_t{acc.count} * comp_size * num_components : 0;
+    }
+
+    static uint64_t primitive_source_bytes(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+    {
+        uint64_t bytes = 0;
+        for (const char* attr : {"POSITION", "NORMAL", "TEXCOORD_0"}) {
+            const auto it = primitive.attributes.find(attr);
+            if (it != primitive.attributes.end())
+                bytes += accessor_bytes(model, it->second);
+        }
+        return bytes + accessor_bytes(model, primitive.indices);
+    }
+
+    // Whether the primitive uses an alphaMode BLEND material.
+    static bool primitive_is_blended(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+    {
+        return primitive.material >= 0 && static_cast<size_t>(primitive.material) < model.materials.size() &&
+               model.materials[primitive.material].alphaMode == "BLEND";
+    }
+
+    bool load_glb_meshes(Model& m, const tinygltf::Model& model, const BufferSpans& buffers, BakedModel* bake, LoadTracker* tracker,
+                         const LoadOptions& options)
+    {
+        LoadTracker untracked(nullptr, nullptr);
+        if (tracker == nullptr)
+            tracker = &untracked;
+
+        // one Model::Primitive per glTF primitive, mesh after mesh
+        std::vector<const tinygltf::Primitive*> primitives{};
+        for (const auto& mesh : model.meshes) {
+            for (const auto& primitive : mesh.primitives)
+                primitives.push_back(&primitive);
+        }
+
+        struct Decoded {
+            size_t primitive_idx;
+            bool ok;
+            MeshData data;
+            VertexCacheStats vertex_cache{};
+            WeldStats weld{};
+            LodStats lods{};
+        };
+
+        // decode on the pool, upload here on the context thread in completion order
+        const double upload_ms = tracker->stage_ms(LoadStage::MESH_UPLOAD);
+        uint64_t source_bytes = 0;
+        tracker->begin(LoadStage::BUFFER_DECODE);
+        CompletionQueue<Decoded> finished{};
+        for (size_t i = 0; i < primitives.size(); i++) {
+            job_system().submit([&, i] {
+                Decoded d{.primitive_idx = i, .ok = false, .data = {}};
+                d.ok = decode_glb_primitive(model, buffers, *primitives[i], d.data);
+                if (d.ok && options.weld_vertices)
+                    mesh_optimizer::weld_vertices(d.data, d.weld, options.weld_epsilon);
+                if (d.ok && options.lod_levels > 0)
+                    mesh_optimizer::generate_lods(d.data, d.lods, options.lod_levels, options.lod_ratio);
+                if (d.ok && options.optimize_meshes)
+                    mesh_optimizer::optimize(d.data, d.vertex_cache, !primitive_is_blended(model, *primitives[i]));
+                finished.push(std::move(d));
+            });
+        }
+
+        // Every primitive gets its range of the shared buffers up front, so uploads can go in any order.
+        // Welding changes the vertex counts and levels of detail the index counts, then the ranges
+        // have to wait for the last primitive.
+        bool ok = true;
+        m.meshes.clear();
+        m.meshes.resize(primitives.size());
+        const auto create = [&](const auto& element_counts) {
+            uint64_t nof_vertices = 0, index_bytes = 0;
+            for (size_t i = 0; i < primitives.size(); i++) {
+                uint64_t primitive_vertices = 0, primitive_indices = 0;
+                element_counts(i, primitive_vertices, primitive_indices);
+                m.meshes[i].base_vertex = static_cast<int32_t>(nof_vertices);
+                place_indices(m.meshes[i], primitive_vertices, primitive_indices, index_bytes);
+                nof_vertices += primitive_vertices;
+            }
+            tracker->begin(LoadStage::MESH_UPLOAD);
+            ok = create_geometry(m.geometry, nof_vertices, index_bytes);
+            tracker->end(LoadStage::MESH_UPLOAD);
+        };
+        const bool counts_known = !options.weld_vertices && options.lod_levels == 0;
+        if (counts_known) {
+            create([&](size_t i, uint64_t& nof_vertices, uint64_t& nof_indices) {
+                primitive_element_counts(model, *primitives[i], nof_vertices, nof_indices);
+            });
+        }
+
+        const auto upload = [&](Decoded& d) {
+            if (ok) {
+                const auto spans = d.data.spans();
+                tracker->begin(LoadStage::MESH_UPLOAD);
+                ok = upload_mesh(m.geometry, m.meshes[d.primitive_idx], spans);
+                tracker->end(LoadStage::MESH_UPLOAD, spans.size_bytes());
+                const uint64_t primitive_bytes = primitive_source_bytes(model, *primitives[d.primitive_idx]);
+                source_bytes += primitive_bytes;
+                tracker->advance(LoadStage::MESH_UPLOAD, primitive_bytes);
+            }
+            if (bake)
+                bake->meshes[d.primitive_idx] = std::move(d.data);
+        };
+
+        if (bake)
+            bake->meshes.resize(primitives.size());
+        std::vector<Decoded> waiting{};
+        for (size_t n = 0; n < primitives.size(); n++) {
+            Decoded d = finished.pop();
+            if (!d.ok) {
+                printf("Failed to decode primitive %zu.\n", d.primitive_idx);
+                ok = false;
+                continue;
+            }
+            tracker->add_weld_stats(d.weld);
+            tracker->add_lod_stats(d.lods);
+            tracker->add_vertex_cache_stats(d.vertex_cache);
+            if (counts_known)
+                upload(d);
+            else
+                waiting.push_back(std::move(d));
+        }
+
+        if (!counts_known && ok) {
+            std::sort(waiting.begin(), waiting.end(), [](const Decoded& a, const Decoded& b) { return a.primitive_idx < b.primitive_idx; });
+            create([&](size_t i, uint64_t& nof_vertices, uint64_t& nof_indices) {
+                nof_vertices = waiting[i].data.positions.size();
+                nof_indices = waiting[i].data.indices.size();
+            });
+            for (auto& d : waiting)
+                upload(d);
+        }
+        tracker->end(LoadStage::BUFFER_DECODE, source_bytes, tracker->stage_ms(LoadStage::MESH_UPLOAD) - upload_ms);
+
+        return ok;
+    }
+
+    void primitive_element_counts(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+                                  uint64_t& nof_vertices, uint64_t& nof_indices)
+    {
+        nof_vertices = 0;
+        nof_indices = 0;
+        const auto it_pos = primitive.attributes.find("POSITION");
+        if (it_pos == primitive.attributes.end())
+            return;
+        nof_vertices = model.accessors[it_pos->second].count;
+        nof_indices = primitive.indices >= 0 ? model.accessors[primitive.indices].count : nof_vertices;
+    }
+
+    bool decode_glb_primitive(const tinygltf::Model& model, const BufferSpans& buffers, const tinygltf::Primitive& primitive,
+                              MeshData& out)
+    {
+        const auto it_pos = primitive.attributes.find("POSITION");
+        if (it_pos == primitive.attributes.end())
+            return true;
+
+        accessor::View pos{};
+        if (!accessor::make_view(model, buffers, model.accessors[it_pos->second], pos))
+            return false;
+
+        accessor::View norm{};
+        const auto it_norm = primitive.attributes.find("NORMAL");
+        const bool has_normals = it_norm != primitive.attributes.end();
+        if (has_normals && !accessor::make_view(model, buffers, model.accessors[it_norm->second], norm))
+            return false;
+
+        accessor::View tc{};
+        const auto it_tc = primitive.attributes.find("TEXCOORD_0");
+        const bool has_tex_coords = it_tc != primitive.attributes.end();
+        if (has_tex_coords && !accessor::make_view(model, buffers, model.accessors[it_tc->second], tc))
+            return false;
+
+        // size everything up front so the decoder writes straight into the final arrays
+        uint64_t nof_vertices = 0;
+        uint64_t nof_indices = 0;
+        primitive_element_counts(model, primitive, nof_vertices, nof_indices);
+        auto& positions = out.positions;
+        auto& normals = out.normals;
+        auto& texCoords = out.texCoords;
+        auto& indices = out.indices;
+        positions.resize(nof_vertices);
+        normals.resize(has_normals ? nof_vertices : 0);
+        texCoords.resize(has_tex_coords ? nof_vertices : 0);
+        indices.resize(nof_indices);
+
+        if (!accessor::read_vertices(
+                pos,
+                has_normals ? &norm : nullptr,
+                has_tex_coords ? &tc : nullptr,
+                positions.data(),
+                has_normals ? normals.data() : nullptr,
+                has_tex_coords ? texCoords.data() : nullptr)) {
+            return false;
+        }
+
+        if (primitive.indices >= 0) {
+            accessor::View ind{};
+            if (!accessor::make_view(model, buffers, model.accessors[primitive.indices], ind) ||
+                !accessor::read_indices(ind, 0, indices.data()))
+                return false;
+        } else {
+            // a triangle soup, every vertex is used once in order
+            std::iota(indices.begin(), indices.end(), 0u);
+        }
+
+        // POSITION accessors must carry min/max, but only trust them for float data
+        const auto& acc = model.accessors[it_pos->second];
+        if (acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT && acc.minValues.size() == 3 && acc.maxValues.size() == 3) {
+            out.bounds_min = glm::vec3(acc.minValues[0], acc.minValues[1], acc.minValues[2]);
+            out.bounds_max = glm::vec3(acc.maxValues[0], acc.maxValues[1], acc.maxValues[2]);
+        } else if (!positions.empty()) {
+            out.bounds_min = positions[0];
+            out.bounds_max = positions[0];
+            for (const auto& p : positions) {
+                out.bounds_min = glm::min(out.bounds_min, p);
+                out.bounds_max = glm::max(out.bounds_max, p);
+            }
+        }
+
+        return true;
+    }
+
+    static uint64_t normals_offset(const Model::Geometry& g) { return uint64_t{g.nof_vertices} * sizeof(glm::vec3); }
+    static uint64_t tex_coords_offset(const Model::Geometry& g) { return uint64_t{g.nof_vertices} * 2 * sizeof(glm::vec3); }
+
+    void place_indices(Model::Primitive& p, uint64_t nof_vertices, uint64_t nof_indices, uint64_t& index_bytes)
+    {
+        p.index_type = nof_vertices <= MAX_SHORT_INDEXED_VERTICES ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        // offsets count whole indices, a 32-bit range after a 16-bit one may need 2 bytes of padding
+        const uint64_t size = index_size(p.index_type);
+        index_bytes = (index_bytes + size - 1) / size * size;
+        p.offset = static_cast<uint32_t>(std::min<uint64_t>(index_bytes / size, UINT32_MAX));
+        index_bytes += nof_indices * size;
+    }
+
+    bool create_geometry(Model::Geometry& g, uint64_t nof_vertices, uint64_t index_bytes)
+    {
+        // base vertices are signed, offsets of 16-bit ranges count 2 bytes
+        if (nof_vertices > INT32_MAX || index_bytes / 2 > UINT32_MAX) {
+            printf("Model exceeds 2^31 vertices or 2^32 indices.\n");
             return false;
         }
+        g.nof_vertices = static_cast<uint32_t>(nof_vertices);
+        g.index_bytes = index_bytes;
+
+        glGenVertexArrays(1, &g.VAO);
+        glBindVertexArray(g.VAO);
+
+        glGenBuffers(1, &g.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, g.VBO);
+        glBufferData(GL_ARRAY_BUFFER, nof_vertices * (2 * sizeof(glm::vec3) + sizeof(glm::vec2)), nullptr, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(POSITION_LOCATION);
+        glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(NORMAL_LOCATION);
+        glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, (void*)normals_offset(g));
+        glEnableVertexAttribArray(TEX_COORD_LOCATION);
+        glVertexAttribPointer(TEX_COORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, (void*)tex_coords_offset(g));
+
+        glGenBuffers(1, &g.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, nullptr, GL_STATIC_DRAW);
+
+        glBindVertexArray(0);
+        return true;
+    }
+
+    void destroy_geometry(Model::Geometry& g)
+    {
+        const uint32_t buffers[] = {g.VBO, g.EBO};
+        glDeleteBuffers(2, buffers);
+        glDeleteVertexArrays(1, &g.VAO);
+        g = Model::Geometry{};
+    }
+
+    bool upload_mesh(const Model::Geometry& g, Model::Primitive& p, const MeshSpans& data)
+    {
+        const auto& positions = data.positions;
+        const auto& normals = data.normals;
+        const auto& texCoords = data.texCoords;
+        const auto& indices = data.indices;
+
+        const uint64_t first_vertex = static_cast<uint64_t>(std::max(p.base_vertex, 0));
+        const uint64_t size = index_size(p.index_type);
+        if (first_vertex + positions.size() > g.nof_vertices || (uint64_t{p.offset} + indices.size()) * size > g.index_bytes) {
+            printf("Mesh does not fit its range of the model geometry.\n");
+            return false;
+        }
+        for (const auto& lod : data.lods) {
+            if (uint64_t{lod.first} + lod.count > indices.size()) {
+                printf("Mesh level of detail is outside its indices.\n");
+                return false;
+            }
+        }
+
+        p.count = data.lods.empty() ? static_cast<uint32_t>(indices.size()) : data.lods[0].first;
+        p.nof_lods = static_cast<uint32_t>(std::min<size_t>(data.lods.size(), MAX_LODS));
+        for (uint32_t l = 0; l < p.nof_lods; l++)
+            p.lods[l] = Model::Primitive::Lod{p.offset + data.lods[l].first, data.lods[l].count, data.lods[l].error};
+        p.bounds_min = data.bounds_min;
+        p.bounds_max = data.bounds_max;
+
+        glBindVertexArray(g.VAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, g.VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, first_vertex * sizeof(glm::vec3), positions.size_bytes(), positions.data());
+
+        if (!normals.empty()) {
+            glBufferSubData(GL_ARRAY_BUFFER, normals_offset(g) + first_vertex * sizeof(glm::vec3), normals.size_bytes(), normals.data());
+        } else {
+            const std::vector<glm::vec3> zeros(positions.size(), glm::vec3(0.0f));
+            glBufferSubData(GL_ARRAY_BUFFER, normals_offset(g) + first_vertex * sizeof(glm::vec3),
+                            zeros.size() * sizeof(glm::vec3), zeros.data());
+        }
+
+        if (!texCoords.empty()) {
+            glBufferSubData(GL_ARRAY_BUFFER, tex_coords_offset(g) + first_vertex * sizeof(glm::vec2), texCoords.size_bytes(), texCoords.data());
+        } else {
+            const std::vector<glm::vec2> zeros(positions.size(), glm::vec2(0.0f));
+            glBufferSubData(GL_ARRAY_BUFFER, tex_coords_offset(g) + first_vertex * sizeof(glm::vec2),
+                            zeros.size() * sizeof(glm::vec2), zeros.data());
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g.EBO);
+        if (p.index_type == GL_UNSIGNED_SHORT) {
+            const std::vector<uint16_t> narrow(indices.begin(), indices.end());
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, uint64_t{p.offset} * size, narrow.size() * sizeof(uint16_t), narrow.data());
+        } else {
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, uint64_t{p.offset} * size, indices.size_bytes(), indices.data());
+        }
 
+        glBindVertexArray(0);
         return true;
     }
 
-    bool load_glb_meshes(Model& m, const tinygltf::Model& model)
+    static Texture::TextureConfig sampler_config(const tinygltf::Sampler* sampler)
     {
-        static const auto to_glm_vec3 = [](const float* data, const size_t size, std::vector<glm::vec3>& out) -> void {
-            out.reserve(size);
-            for (size_t i = 0; i < size * 3; i += 3)
-                out.emplace_back(data[i + 0], data[i + 1], data[i + 2]);
+        // glTF leaves filters undefined when there is no sampler, wrap defaults to REPEAT
+        const auto filter_or = [](int filter, uint32_t fallback) {
+            return filter == -1 ? fallback : static_cast<uint32_t>(filter);
         };
-    
-        static const auto to_glm_vec2 = [](const float* data, const size_t size, std::vector<glm::vec2>& out) -> void {
-            out.reserve(size);
-            for (size_t i = 0; i < size * 3; i += 2)
-                out.emplace_back(data[i + 0], data[i + 1]);
+
+        return Texture::TextureConfig{
+            .target = GL_TEXTURE_2D,
+            .min_filter = sampler ? filter_or(sampler->minFilter, GL_LINEAR_MIPMAP_LINEAR) : GL_LINEAR_MIPMAP_LINEAR,
+            .mag_filter = sampler ? filter_or(sampler->magFilter, GL_LINEAR) : GL_LINEAR,
+            .wrap_s = sampler ? static_cast<uint32_t>(sampler->wrapS) : GL_REPEAT,
+            .wrap_t = sampler ? static_cast<uint32_t>(sampler->wrapT) : GL_REPEAT,
         };
-    
-        std::vector<glm::vec3> positions{};
-        std::vector<glm::vec3> normals{};
-        std::vector<glm::vec2> texCoords{};
-    
-        uint32_t nof_indices = 0;
-        for (const auto& mesh : model.meshes) {
-            for (const auto& primitive : mesh.primitives) {
-                const auto& acc_ind = model.accessors[primitive.indices];
-                nof_indices += acc_ind.count;
+    }
+
+    static Texture::TextureConfig image_config(const tinygltf::Image& img, const Texture::TextureConfig& sampler)
+    {
+        Texture::TextureConfig tc = sampler;
+        tc.internalformat = static_cast<uint32_t>(img.component);
+        tc.format = static_cast<uint32_t>(img.bits);
+        tc.type = static_cast<uint32_t>(img.pixel_type);
+        tc.width = static_cast<uint32_t>(img.width);
+        tc.height = static_cast<uint32_t>(img.height);
+        return tc;
+    }
+
+    static int32_t create_texture(const Texture::TextureConfig& tc, const unsigned char* data)
+    {
+        Texture t{};
+        if (!t.create_texture(tc, data)) {
+            return -1;
+        }
+        textures.push_back(t);
+        return static_cast<int32_t>(textures.size() - 1);
+    }
+
+    static std::span<const unsigned char> compressed_image_bytes(
+        const tinygltf::Model& model,
+        const BufferSpans& buffers,
+        const tinygltf::Image& img
+    ) {
+        if (!img.image.empty())
+            return img.image;
+        if (img.bufferView >= 0 && static_cast<size_t>(img.bufferView) < model.bufferViews.size()) {
+            const auto& bv = model.bufferViews[img.bufferView];
+            if (static_cast<size_t>(bv.buffer) < buffers.size() && bv.byteOffset + bv.byteLength <= buffers[bv.buffer].size())
+                return buffers[bv.buffer].subspan(bv.byteOffset, bv.byteLength);
+        }
+        return {};
+    }
+
+    // Hash of the image as stored in the source file. Images without a bufferView hash whatever
+    // tinygltf left in Image::image. 0 if there is nothing to hash.
+    static uint64_t image_content_hash(const tinygltf::Model& model, const BufferSpans& buffers, const tinygltf::Image& img)
+    {
+        std::span<const unsigned char> bytes{};
+        if (img.bufferView >= 0 && static_cast<size_t>(img.bufferView) < model.bufferViews.size()) {
+            const auto& bv = model.bufferViews[img.bufferView];
+            if (static_cast<size_t>(bv.buffer) < buffers.size() && bv.byteOffset + bv.byteLength <= buffers[bv.buffer].size())
+                bytes = buffers[bv.buffer].subspan(bv.byteOffset, bv.byteLength);
+        }
+        if (bytes.empty())
+            bytes = img.image;
+        if (bytes.empty())
+            return 0;
+        const uint64_t h = hash_bytes(bytes.data(), bytes.size(), bytes.size());
+        return h != 0 ? h : 1;
+    }
+
+    // Size of the image as stored in the source file, for progress reporting.
+    static uint64_t image_source_bytes(const tinygltf::Model& model, size_t image_idx)
+    {
+        const int bv = model.images[image_idx].bufferView;
+        return bv >= 0 && static_cast<size_t>(bv) < model.bufferViews.size() ? model.bufferViews[bv].byteLength : 0;
+    }
+
+    bool capture_image_bytes(tinygltf::Image* image, const int, std::string*, std::string*,
+                             int, int, const unsigned char* bytes, int size, void*)
+    {
+        image->image.assign(bytes, bytes + size);
+        image->as_is = true;
+        return true;
+    }
+
+    void start_image_decode(const tinygltf::Model& model, const BufferSpans& buffers, ImageBatch& batch,
+                            const std::vector<bool>* needed)
+    {
+        for (size_t i = 0; i < model.images.size(); i++) {
+            if (needed && (i >= needed->size() || !(*needed)[i]))
+                continue;
+            batch.nof_jobs++;
+            job_system().submit([&, i] {
+                const auto start = std::chrono::steady_clock::now();
+                const auto& src = model.images[i];
+                const auto bytes = compressed_image_bytes(model, buffers, src);
+
+                DecodedImage d{};
+                d.image_idx = i;
+                d.compressed_size = bytes.size();
+                d.image.name = src.name;
+                std::string err, warn;
+                d.ok = !bytes.empty() && tinygltf::LoadImageData(
+                    &d.image, static_cast<int>(i), &err, &warn, 0, 0,
+                    bytes.data(), static_cast<int>(bytes.size()), nullptr);
+                if (!err.empty())
+                    printf("Err: %s\n", err.c_str());
+
+                d.decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                batch.finished.push(std::move(d));
+            });
+        }
+    }
+
+    ImageBatch::~ImageBatch()
+    {
+        // jobs reference the tinygltf model, never let them outlive it
+        for (; nof_jobs > 0; nof_jobs--)
+            finished.pop();
+    }
+
+    int32_t find_cached_texture(uint64_t content_key)
+    {
+        if (content_key == 0)
+            return -1;
+        const auto it = texture_cache.find(content_key);
+        return it != texture_cache.end() && static_cast<size_t>(it->second) < textures.size() ? it->second : -1;
+    }
+
+    void cache_texture(uint64_t content_key, int32_t texture_idx)
+    {
+        if (content_key != 0 && texture_idx >= 0)
+            texture_cache[content_key] = texture_idx;
+    }
+
+    void clear_texture_cache()
+    {
+        texture_cache.clear();
+    }
+
+    TexturePlan plan_textures(const tinygltf::Model& model, const BufferSpans& buffers)
+    {
+        TexturePlan plan{};
+        plan.slot_of_texture.assign(model.textures.size(), -1);
+        plan.decode_image.assign(model.images.size(), false);
+
+        // only textures the materials actually sample get uploaded
+        std::vector<bool> used(model.textures.size(), false);
+        const auto mark_used = [&](int idx) {
+            if (idx >= 0 && static_cast<size_t>(idx) < used.size())
+                used[idx] = true;
+        };
+        for (const auto& mat : model.materials) {
+            mark_used(mat.pbrMetallicRoughness.baseColorTexture.index);
+            mark_used(mat.pbrMetallicRoughness.metallicRoughnessTexture.index);
+        }
+
+        std::vector<uint64_t> image_hashes(model.images.size(), 0);
+        job_system().parallel_for(model.images.size(), [&](size_t i) {
+            image_hashes[i] = image_content_hash(model, buffers, model.images[i]);
+        });
+
+        // slots are identified by content key, or by (image, sampler) for images without bytes
+        std::map<std::pair<int, uint64_t>, int32_t> slot_of_key{};
+        for (size_t t = 0; t < model.textures.size(); t++) {
+            const auto& texture = model.textures[t];
+            if (!used[t] || texture.source < 0 || static_cast<size_t>(texture.source) >= model.images.size())
+                continue;
+
+            TexturePlan::Slot slot{};
+            slot.image = texture.source;
+            slot.sampler = sampler_config(texture.sampler >= 0 ? &model.samplers[texture.sampler] : nullptr);
+            const uint64_t sampler_hash = hash_bytes(&slot.sampler, sizeof(slot.sampler));
+            if (image_hashes[slot.image] != 0)
+                slot.content_key = hash_bytes(&sampler_hash, sizeof(sampler_hash), image_hashes[slot.image]) | 1;
+
+            const auto key = slot.content_key != 0 ? std::pair{-1, slot.content_key} : std::pair{slot.image, sampler_hash};
+            if (const auto it = slot_of_key.find(key); it != slot_of_key.end()) {
+                plan.slot_of_texture[t] = it->second;
+                continue;
+            }
+
+            slot.texture_idx = find_cached_texture(slot.content_key);
+            if (slot.texture_idx == -1)
+                plan.decode_image[slot.image] = true;
+            plan.slot_of_texture[t] = static_cast<int32_t>(plan.slots.size());
+            slot_of_key.emplace(key, plan.slot_of_texture[t]);
+            plan.slots.push_back(slot);
+        }
+
+        return plan;
+    }
+
+    bool load_glb_textures(
+        const tinygltf::Model& model,
+        const BufferSpans& buffers,
+        const LoadOptions& options,
+        ImageBatch* batch,
+        TexturePlan& plan,
+        std::vector<int32_t>& texture_table,
+        BakedModel* bake,
+        LoadTracker* tracker
+    ) {
+        LoadTracker untracked(nullptr, nullptr);
+        if (tracker == nullptr)
+            tracker = &untracked;
+
+        // textures shared with an earlier load still go into the bake so the cache stands on its own
+        for (const auto& slot : plan.slots) {
+            if (bake == nullptr || slot.texture_idx == -1)
+                continue;
+            const auto& img = model.images[slot.image];
+            BakedModel::BakedTexture baked{.conf = slot.sampler, .content_key = slot.content_key, .texture_idx = slot.texture_idx};
+            if (img.width > 0 && !img.image.empty()) {
+                // decoded by tinygltf while parsing
+                baked.conf = image_config(img, slot.sampler);
+                baked.payload = img.image;
+            } else {
+                const auto bytes = compressed_image_bytes(model, buffers, img);
+                baked.compressed = true;
+                baked.decode_on_load = !options.lazy_textures;
+                baked.payload.assign(bytes.begin(), bytes.end());
             }
+            bake->textures.push_back(std::move(baked));
         }
-    
-        std::vector<uint32_t> indices{};
-        indices.reserve(nof_indices);
-    
-        m.meshes.resize(model.meshes.size());
-        for (size_t i = 0; i < model.meshes.size(); i++) {
-            const auto& mesh = model.meshes[i];
-    
-            std::vector<glm::vec3> positions;
-            std::vector<glm::vec3> normals;
-            std::vector<glm::vec2> texCoords;
-            std::vector<uint32_t> indices;
-    
-            uint32_t index_offset = 0;
-    
-            for (const auto& primitive : mesh.primitives) {
-                if (primitive.attributes.find("POSITION") != primitive.attributes.end()) {
-                    const auto& acc_pos = model.accessors[primitive.attributes.at("POSITION")];
-                    const auto& bv_pos = model.bufferViews[acc_pos.bufferView];
-                    const auto& buffer = model.buffers[bv_pos.buffer];
-                    const float* data_pos = reinterpret_cast<const float*>(&buffer.data[bv_pos.byteOffset + acc_pos.byteOffset]);
-                    to_glm_vec3(data_pos, acc_pos.count, positions);
-                }
-    
-                if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-                    const auto& acc_norm = model.accessors[primitive.attributes.at("NORMAL")];
-                    const auto& bv_norm = model.bufferViews[acc_norm.bufferView];
-                    const auto& buffer = model.buffers[bv_norm.buffer];
-                    const float* data_norm = reinterpret_cast<const float*>(&buffer.data[bv_norm.byteOffset + acc_norm.byteOffset]);
-                    to_glm_vec3(data_norm, acc_norm.count, normals);
-                }
-    
-                if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-                    const auto& acc_tc = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-                    const auto& bv_tc = model.bufferViews[acc_tc.bufferView];
-                    const auto& buffer = model.buffers[bv_tc.buffer];
-                    const float* data_tc = reinterpret_cast<const float*>(&buffer.data[bv_tc.byteOffset + acc_tc.byteOffset]);
-                    to_glm_vec2(data_tc, acc_tc.count, texCoords);
+        for (size_t i = 0; i < model.images.size(); i++) {
+            if (!plan.decode_image[i])
+                tracker->advance(LoadStage::TEXTURE_UPLOAD, image_source_bytes(model, i));
+        }
+
+        const auto resolve_table = [&] {
+            texture_table.assign(model.textures.size(), -1);
+            for (size_t t = 0; t < model.textures.size(); t++) {
+                if (plan.slot_of_texture[t] >= 0)
+                    texture_table[t] = plan.slots[plan.slot_of_texture[t]].texture_idx;
+            }
+            return true;
+        };
+
+        // every slot of the image is created from the one decode
+        const auto upload = [&](size_t image_idx, const tinygltf::Image& img) {
+            for (auto& slot : plan.slots) {
+                if (slot.image != static_cast<int>(image_idx) || slot.texture_idx != -1)
+                    continue;
+                const auto tc = image_config(img, slot.sampler);
+                tracker->begin(LoadStage::TEXTURE_UPLOAD);
+                slot.texture_idx = create_texture(tc, img.image.data());
+                tracker->end(LoadStage::TEXTURE_UPLOAD, img.image.size());
+                if (slot.texture_idx == -1)
+                    continue;
+                cache_texture(slot.content_key, slot.texture_idx);
+                if (bake) {
+                    bake->textures.push_back({.conf = tc, .content_key = slot.content_key,
+                                              .texture_idx = slot.texture_idx, .payload = img.image});
                 }
-    
-                // Handling indices correctly
-                if (primitive.indices >= 0) {
-                    const auto& acc_ind = model.accessors[primitive.indices];
-                    const auto& bv_ind = model.bufferViews[acc_ind.bufferView];
-                    const auto& buffer = model.buffers[bv_ind.buffer];
-    
-                    switch(acc_ind.componentType) {
-                        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                            indices.insert(indices.end(),
-                                reinterpret_cast<const GLubyte*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                                reinterpret_cast<const GLubyte*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                            break;
-                        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                            indices.insert(indices.end(),
-                                reinterpret_cast<const GLushort*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                                reinterpret_cast<const GLushort*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                            break;
-                        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                            indices.insert(indices.end(),
-                                reinterpret_cast<const GLuint*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                                reinterpret_cast<const GLuint*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                            break;
-                        default:
-                            printf("Unsupported index component type %d\n", acc_ind.componentType);
-                            return false;
-                    }
+            }
+            tracker->advance(LoadStage::TEXTURE_UPLOAD, image_source_bytes(model, image_idx));
+        };
+
+        if (options.lazy_textures) {
+            // keep the compressed bytes around, Texture::acquire() decodes on first bind
+            for (auto& slot : plan.slots) {
+                if (slot.texture_idx != -1)
+                    continue;
+                const auto bytes = compressed_image_bytes(model, buffers, model.images[slot.image]);
+                if (bytes.empty())
+                    continue;
+                Texture lazy{};
+                tracker->begin(LoadStage::TEXTURE_UPLOAD);
+                lazy.create_lazy(slot.sampler, bytes);
+                tracker->end(LoadStage::TEXTURE_UPLOAD);
+                textures.push_back(lazy);
+                slot.texture_idx = static_cast<int32_t>(textures.size() - 1);
+                cache_texture(slot.content_key, slot.texture_idx);
+                if (bake) {
+                    bake->textures.push_back({.conf = slot.sampler, .compressed = true, .content_key = slot.content_key,
+                                              .texture_idx = slot.texture_idx, .payload = {bytes.begin(), bytes.end()}});
                 }
+                tracker->advance(LoadStage::TEXTURE_UPLOAD, bytes.size());
             }
-    
-            m.meshes[i].offset = index_offset;
-            m.meshes[i].count = indices.size();
-            index_offset += indices.size();
-    
-            glGenVertexArrays(1, &m.meshes[i].VAO);
-            glBindVertexArray(m.meshes[i].VAO);
-    
-            glGenBuffers(1, &m.meshes[i].VBO_pos);
-            glBindBuffer(GL_ARRAY_BUFFER, m.meshes[i].VBO_pos);
-            glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
-            glEnableVertexAttribArray(POSITION_LOCATION);
-            glVertexAttribPointer(POSITION_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    
-            if (!normals.empty()) {
-                glGenBuffers(1, &m.meshes[i].VBO_norm);
-                glBindBuffer(GL_ARRAY_BUFFER, m.meshes[i].VBO_norm);
-                glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
-                glEnableVertexAttribArray(NORMAL_LOCATION);
-                glVertexAttribPointer(NORMAL_LOCATION, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            return resolve_table();
+        }
+
+        if (batch == nullptr) {
+            for (size_t i = 0; i < model.images.size(); i++) {
+                if (plan.decode_image[i])
+                    upload(i, model.images[i]);
             }
-    
-            if (!texCoords.empty()) {
-                glGenBuffers(1, &m.meshes[i].VBO_tc);
-                glBindBuffer(GL_ARRAY_BUFFER, m.meshes[i].VBO_tc);
-                glBufferData(GL_ARRAY_BUFFER, texCoords.size() * sizeof(glm::vec2), texCoords.data(), GL_STATIC_DRAW);
-                glEnableVertexAttribArray(TEX_COORD_LOCATION);
-                glVertexAttribPointer(TEX_COORD_LOCATION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+            return resolve_table();
+        }
+
+        // upload in completion order while the remaining images are still decoding
+        std::vector<DecodedImage> report{};
+        uint64_t compressed_bytes = 0;
+        if (batch->nof_jobs == 0)
+            tracker->end(LoadStage::IMAGE_DECODE);
+        for (; batch->nof_jobs > 0; batch->nof_jobs--) {
+            DecodedImage d = batch->finished.pop();
+            compressed_bytes += d.compressed_size;
+            if (batch->nof_jobs == 1)
+                tracker->end(LoadStage::IMAGE_DECODE, compressed_bytes);
+            if (!d.ok) {
+                printf("Failed to decode image %zu ('%s'), skipping.\n", d.image_idx, d.image.name.c_str());
+                continue;
+            }
+            upload(d.image_idx, d.image);
+
+            if (batch->report) {
+                d.image.image.clear();
+                d.image.image.shrink_to_fit();
+                report.push_back(std::move(d));
             }
-    
-            glGenBuffers(1, &m.meshes[i].EBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.meshes[i].EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
-    
-            glBindVertexArray(0);
         }
 
-        return true;
+        if (batch->report && !report.empty()) {
+            std::sort(report.begin(), report.end(), [](const auto& a, const auto& b) { return a.decode_ms > b.decode_ms; });
+            double total_ms = 0.0;
+            printf("Image decode times (%zu images, %zu workers):\n", report.size(), job_system().size());
+            for (const auto& d : report) {
+                total_ms += d.decode_ms;
+                printf("  %8.2f ms  %5dx%-5d %8.1f KiB  [%zu] %s\n",
+                    d.decode_ms, d.image.width, d.image.height, d.compressed_size / 1024.0,
+                    d.image_idx, d.image.name.c_str());
+            }
+            printf("  %8.2f ms  total decode time across workers\n", total_ms);
+        }
+
+        return resolve_table();
     }
 
-    bool load_glb_materials(Model &mo, const tinygltf::Model &model)
+    bool load_glb_materials(Model &mo, const tinygltf::Model &model, const std::vector<int32_t>& texture_table)
     {
-        int32_t mat_idx = 0;
-        for (size_t i = 0; i < model.meshes.size(); i++) {
-            const auto& mesh = model.meshes[i];
+        const auto lookup_texture = [&](int gltf_texture_idx) -> int32_t {
+            if (gltf_texture_idx < 0 || static_cast<size_t>(gltf_texture_idx) >= texture_table.size())
+                return -1;
+            return texture_table[gltf_texture_idx];
+        };
 
-            assert(mesh.primitives.size() == 1 && "mesh.primitives is > 1.");
-            for (const auto& primitive : mesh.primitives) {
-                const auto& mat = model.materials[primitive.material];
-                const auto& pbrMR = mat.pbrMetallicRoughness;
-
-                Material m{};
-                if (mat.alphaMode == "OPAQUE") {
-                    m.mode = Material::AlphaMode::OPAQUE;
-                } else if (mat.alphaMode == "MASK") {
-                    m.mode = Material::AlphaMode::MASK;
-                    m.alpha_cutoff = mat.alphaCutoff;
-                } else if (mat.alphaMode == "BLEND") {
-                    m.mode = Material::AlphaMode::BLEND;
-                }
+        // one Material per glTF material, created on first use and shared by all its primitives
+        std::vector<int32_t> material_table(model.materials.size(), -1);
+        const auto load_material = [&](int gltf_material_idx) -> int32_t {
+            if (gltf_material_idx < 0 || static_cast<size_t>(gltf_material_idx) >= model.materials.size())
+                return -1;
+            if (material_table[gltf_material_idx] != -1)
+                return material_table[gltf_material_idx];
 
-                m.double_sided = mat.doubleSided;
-
-                m.base_color.r = pbrMR.baseColorFactor[0];
-                m.base_color.g = pbrMR.baseColorFactor[1];
-                m.base_color.b = pbrMR.baseColorFactor[2];
-                m.base_color.a = pbrMR.baseColorFactor[3];
-
-                m.metalness = pbrMR.metallicFactor;
-                m.roughness = pbrMR.roughnessFactor;
-
-                static auto load_texture = [&](
-                    const tinygltf::Image& img,
-                    const tinygltf::Sampler& sampler
-                ) -> bool {
-                    Texture::TextureConfig tc{
-                        .target = GL_TEXTURE_2D,
-                        .min_filter = sampler.minFilter,
-                        .mag_filter = sampler.magFilter,
-                        .wrap_s = sampler.wrapS,
-                        .wrap_t = sampler.wrapT,
-                        .internalformat = img.component,
-                        .format = img.bits,
-                        .type = img.pixel_type,
-                        .width = img.width,
-                        .height = img.height,
-                    };
-                    Texture t{};
-                    if (!t.create_texture(tc, img.image.data())) {
-                        return false;
-                    }
-                    textures.push_back(t);
-                    return true;
-                };
-
-                if (pbrMR.baseColorTexture.index != -1) {
-                    const auto& baseColorTexture = model.textures[pbrMR.baseColorTexture.index];
-                    const auto& baseColorTextureImage = model.images[baseColorTexture.source];
-                    const auto& baseColorTextureSampler = model.samplers[baseColorTexture.sampler];
-                    if (!load_texture(baseColorTextureImage, baseColorTextureSampler)) {
-                        printf("Failed to load baseColorTexture, skipping.\n");
-                    }
-                    m.base_color_texture_idx = textures.size() - 1;
-                }
+            const auto& mat = model.materials[gltf_material_idx];
+            const auto& pbrMR = mat.pbrMetallicRoughness;
+
+            Material m{};
+            if (mat.alphaMode == "OPAQUE") {
+                m.mode = Material::AlphaMode::OPAQUE;
+            } else if (mat.alphaMode == "MASK") {
+                m.mode = Material::AlphaMode::MASK;
+                m.alpha_cutoff = mat.alphaCutoff;
+            } else if (mat.alphaMode == "BLEND") {
+                m.mode = Material::AlphaMode::BLEND;
+            }
+
+            m.double_sided = mat.doubleSided;
+
+            m.base_color.r = pbrMR.baseColorFactor[0];
+            m.base_color.g = pbrMR.baseColorFactor[1];
+            m.base_color.b = pbrMR.baseColorFactor[2];
+            m.base_color.a = pbrMR.baseColorFactor[3];
+
+            m.metalness = pbrMR.metallicFactor;
+            m.roughness = pbrMR.roughnessFactor;
+
+            if (pbrMR.baseColorTexture.index != -1) {
+                m.base_color_texture_idx = lookup_texture(pbrMR.baseColorTexture.index);
+                if (m.base_color_texture_idx == -1)
+                    printf("Failed to load baseColorTexture, skipping.\n");
+            }
+
+            if (pbrMR.metallicRoughnessTexture.index != -1) {
+                m.metallic_roughness_texture_idx = lookup_texture(pbrMR.metallicRoughnessTexture.index);
+                if (m.metallic_roughness_texture_idx == -1)
+                    printf("Failed to load metallicRoughnessTexture, skipping.\n");
+            }
+
+            // TODO: normal texture
+
+            // TODO: emissiveness texture
 
-                if (pbrMR.metallicRoughnessTexture.index != -1) {
-                    const auto& metallicRoughnessTexture = model.textures[pbrMR.metallicRoughnessTexture.index];
-                    const auto& metallicRoughnessTextureImage = model.images[metallicRoughnessTexture.source];
-                    const auto& metallicRoughnessTextureSampler = model.samplers[metallicRoughnessTexture.sampler];
-                    if (!load_texture(metallicRoughnessTextureImage, metallicRoughnessTextureSampler)) {
-                        printf("Failed to load metallicRoughnessTexture, skipping.\n");
-                    }
-                    m.metallic_roughness_texture_idx = textures.size() - 1;
+            materials.push_back(m);
+            material_table[gltf_material_idx] = static_cast<int32_t>(materials.size() - 1);
+            return material_table[gltf_material_idx];
+        };
+
+        // m.meshes holds the primitives mesh after mesh, see load_glb_meshes()
+        size_t next = 0;
+        for (const auto& mesh : model.meshes) {
+            for (const auto& primitive : mesh.primitives) {
+                if (next == mo.meshes.size()) {
+                    printf("The model has more primitives than were loaded.\n");
+                    return false;
                 }
+                mo.meshes[next++].mat_idx = load_material(primitive.material);
+            }
+        }
 
-                // TODO: normal texture
+        return true;
+    }
 
-                // TODO: emissiveness texture
+    // EXT_mesh_gpu_instancing: the node's mesh is drawn once per element of its TRANSLATION/ROTATION/SCALE
+    // accessors, each at node world * instance TRS. The instances go straight into m.instances with their
+    // TRS matrix in m.instance_offsets, no nodes are created for them.
+    static bool load_gpu_instances(Model& m, const tinygltf::Model& model, const BufferSpans& buffers,
+                                   const tinygltf::Node& node, uint32_t node_idx)
+    {
+        const auto& ext = node.extensions.at("EXT_mesh_gpu_instancing");
+        if (!ext.IsObject() || !ext.Has("attributes") || !ext.Get("attributes").IsObject()) {
+            printf("EXT_mesh_gpu_instancing on node '%s' has no attributes.\n", node.name.c_str());
+            return false;
+        }
+        const auto& attributes = ext.Get("attributes");
 
-                materials.push_back(m);
-                mo.meshes[i].mat_idx = mat_idx;
-                mat_idx++;
+        const char* names[3] = {"TRANSLATION", "ROTATION", "SCALE"};
+        accessor::View views[3]{};
+        bool present[3]{};
+        size_t count = 0;
+        for (int a = 0; a < 3; a++) {
+            if (!attributes.Has(names[a]))
+                continue;
+            const int acc_idx = attributes.Get(names[a]).GetNumberAsInt();
+            if (acc_idx < 0 || static_cast<size_t>(acc_idx) >= model.accessors.size() ||
+                !accessor::make_view(model, buffers, model.accessors[acc_idx], views[a])) {
+                printf("EXT_mesh_gpu_instancing on node '%s' has an invalid %s accessor.\n", node.name.c_str(), names[a]);
+                return false;
             }
+            if (count != 0 && views[a].count != count) {
+                printf("EXT_mesh_gpu_instancing on node '%s' has mismatching accessor counts.\n", node.name.c_str());
+                return false;
+            }
+            count = views[a].count;
+            present[a] = true;
         }
+        if (count == 0)
+            return true;
+
+        std::vector<glm::vec3> translations(count, glm::vec3(0.0f));
+        std::vector<glm::vec4> rotations(count, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        std::vector<glm::vec3> scales(count, glm::vec3(1.0f));
+        if ((present[0] && !accessor::read_vec3(views[0], translations.data())) ||
+            (present[1] && !accessor::read_vec4(views[1], rotations.data())) ||
+            (present[2] && !accessor::read_vec3(views[2], scales.data())))
+            return false;
 
+        const size_t first_offset = m.instance_offsets.size();
+        m.instance_offsets.resize(first_offset + count);
+        compose_trs(glm::mat4(1.0f), translations.data(), rotations.data(), scales.data(), count,
+                    m.instance_offsets.data() + first_offset);
+
+        const size_t first = m.instances.size();
+        m.instances.resize(first + count, Model::Instance{.primitive = static_cast<uint32_t>(node.mesh), .node = node_idx});
+        for (size_t i = 0; i < count; i++)
+            m.instances[first + i].offset = static_cast<uint32_t>(first_offset + i);
         return true;
     }
 
-    bool load_glb_transformations(Model& m, const tinygltf::Model &model)
+    bool load_glb_transformations(Model& m, const tinygltf::Model &model, const BufferSpans& buffers, int32_t scene)
     {
-        assert(model.scenes.size() == 1 && "Found several scenes. Only supporting single scene.");
-        const tinygltf::Scene& scene = model.scenes[0];
-        const auto& nodes = scene.nodes;
+        std::vector<int> roots{};
+        if (model.scenes.empty()) {
+            // nothing to pick from, take every node that is nobody's child
+            std::vector<uint8_t> is_child(model.nodes.size(), 0);
+            for (const auto& node : model.nodes) {
+                for (const int child : node.children) {
+                    if (child >= 0 && static_cast<size_t>(child) < model.nodes.size())
+                        is_child[child] = 1;
+                }
+            }
+            for (size_t i = 0; i < model.nodes.size(); i++) {
+                if (!is_child[i])
+                    roots.push_back(static_cast<int>(i));
+            }
+        } else {
+            if (scene < 0)
+                scene = model.defaultScene >= 0 ? model.defaultScene : 0;
+            if (static_cast<size_t>(scene) >= model.scenes.size()) {
+                printf("Scene %d does not exist, the model has %zu.\n", scene, model.scenes.size());
+                return false;
+            }
+            roots = model.scenes[scene].nodes;
+        }
+
+        m.nodes = TransformHierarchy{};
+        m.instances.clear();
+        m.instance_offsets.clear();
 
         struct StkEntry {
-            const tinygltf::Node& node;
-            glm::mat4x4 model_matrix{1.0f};
+            int node;
+            int32_t parent;
         };
 
+        // depth-first pre-order, the order TransformHierarchy wants. Pushed in reverse so siblings
+        // keep their file order.
         std::stack<StkEntry> stk{};
-        stk.push(StkEntry{
-            .node = model.nodes[nodes[0]],
-            .model_matrix = vec_to_glm_mat4x4(model.nodes[nodes[0]].matrix)
-        });
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+            stk.push(StkEntry{.node = *it, .parent = TransformHierarchy::NO_PARENT});
 
         while (!stk.empty()) {
-            const auto parent = stk.top();
+            const auto entry = stk.top();
             stk.pop();
+            if (entry.node < 0 || static_cast<size_t>(entry.node) >= model.nodes.size()) {
+                printf("Node index %d is out of range.\n", entry.node);
+                return false;
+            }
+            // glTF nodes form a forest, anything visited more often than there are nodes has a cycle
+            if (m.nodes.size() == model.nodes.size()) {
+                printf("The node hierarchy is not a tree.\n");
+                return false;
+            }
 
-            if (parent.node.mesh != -1) {
-                m.meshes[parent.node.mesh].model_matrix = parent.model_matrix;
+            const auto& node = model.nodes[entry.node];
+            uint32_t idx;
+            if (!node.matrix.empty()) {
+                idx = m.nodes.add(entry.parent, vec_to_glm_mat4x4(node.matrix));
+            } else {
+                const auto& t = node.translation;
+                const auto& r = node.rotation;
+                const auto& s = node.scale;
+                idx = m.nodes.add(entry.parent,
+                    t.size() == 3 ? glm::vec3(t[0], t[1], t[2]) : glm::vec3(0.0f),
+                    r.size() == 4 ? glm::vec4(r[0], r[1], r[2], r[3]) : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),
+                    s.size() == 3 ? glm::vec3(s[0], s[1], s[2]) : glm::vec3(1.0f));
             }
 
-            // process children
-            for (const auto& child_idx : parent.node.children) {
-                const auto& child_node = model.nodes[child_idx];
-                const auto& child_matrix = get_node_transform(child_node);
-                stk.push(StkEntry{
-                    .node = model.nodes[child_idx],
-//                    .model_matrix = child_matrix * parent.model_matrix
-                    .model_matrix = parent.model_matrix * child_matrix
+            // every node referencing a mesh is a placement of it, several nodes may share one mesh
+            if (node.mesh != -1) {
+                if (node.mesh < 0 || static_cast<size_t>(node.mesh) >= model.meshes.size()) {
+                    printf("Node '%s' references missing mesh %d.\n", node.name.c_str(), node.mesh);
+                    return false;
+                }
+                if (node.extensions.count("EXT_mesh_gpu_instancing") != 0) {
+                    if (!load_gpu_instances(m, model, buffers, node, idx))
+                        return false;
+                } else {
+                    // .primitive holds the mesh until the instances are expanded below
+                    m.instances.push_back(Model::Instance{.primitive = static_cast<uint32_t>(node.mesh), .node = idx});
+                }
+            }
 
-                });
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+                stk.push(StkEntry{.node = *it, .parent = static_cast<int32_t>(idx)});
+        }
+
+        m.nodes.finalize();
+
+        // the instances so far place glTF meshes, give each of the mesh's primitives its own
+        std::vector<uint32_t> first_primitive(model.meshes.size() + 1, 0);
+        for (size_t i = 0; i < model.meshes.size(); i++)
+            first_primitive[i + 1] = first_primitive[i] + static_cast<uint32_t>(model.meshes[i].primitives.size());
+        if (first_primitive.back() != m.meshes.size()) {
+            printf("The model has a different number of primitives than were loaded.\n");
+            return false;
+        }
+        std::vector<Model::Instance> placed{};
+        for (const auto& inst : m.instances) {
+            for (uint32_t p = first_primitive[inst.primitive]; p < first_primitive[inst.primitive + 1]; p++) {
+                placed.push_back(inst);
+                placed.back().primitive = p;
             }
         }
+        m.instances.swap(placed);
 
+        group_instances(m);
         return true;
     }
 
+    void group_instances(Model& m)
+    {
+        for (auto& p : m.meshes) {
+            p.first_instance = 0;
+            p.instance_count = 0;
+        }
+        for (const auto& inst : m.instances)
+            m.meshes[inst.primitive].instance_count++;
+        uint32_t first = 0;
+        for (auto& p : m.meshes) {
+            p.first_instance = first;
+            first += p.instance_count;
+        }
+
+        // counting sort, stable so instances of one primitive keep their scene graph order
+        std::vector<uint32_t> next(m.meshes.size());
+        for (size_t i = 0; i < m.meshes.size(); i++)
+            next[i] = m.meshes[i].first_instance;
+        std::vector<Model::Instance> grouped(m.instances.size());
+        for (const auto& inst : m.instances)
+            grouped[next[inst.primitive]++] = inst;
+        m.instances.swap(grouped);
+    }
+
+    void update_transforms(Model& m)
+    {
+        if (m.nodes.update() == 0)
+            return;
+
+        m.bounds.resize(m.instances.size());
+        const auto refresh = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                auto& inst = m.instances[i];
+                if (!m.nodes.changed[inst.node])
+                    continue;
+                const glm::mat4& world = m.nodes.world[inst.node];
+                inst.model_matrix = inst.offset == Model::Instance::NO_OFFSET ? world : world * m.instance_offsets[inst.offset];
+                const auto& p = m.meshes[inst.primitive];
+                m.bounds.set(i, inst.model_matrix, p.bounds_min, p.bounds_max);
+            }
+        };
+
+        const size_t count = m.instances.size();
+        if (count < PARALLEL_TRANSFORM_THRESHOLD) {
+            refresh(0, count);
+            return;
+        }
+        constexpr size_t CHUNK = 4096;
+        job_system().parallel_for((count + CHUNK - 1) / CHUNK, [&](size_t chunk) {
+            refresh(chunk * CHUNK, std::min(chunk * CHUNK + CHUNK, count));
+        });
+    }
+
+    uint32_t placeholder_texture(const glm::vec4& color)
+    {
+        static std::unordered_map<uint32_t, uint32_t> cache{};
+
+        const auto to_u8 = [](float c) {
+            return static_cast<unsigned char>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+        };
+        const unsigned char rgba[4] = {to_u8(color.r), to_u8(color.g), to_u8(color.b), to_u8(color.a)};
+        uint32_t key;
+        std::memcpy(&key, rgba, sizeof(key));
+
+        if (const auto it = cache.find(key); it != cache.end())
+            return it->second;
+
+        Texture t{};
+        const Texture::TextureConfig tc{
+            .target = GL_TEXTURE_2D,
+            .min_filter = GL_NEAREST,
+            .mag_filter = GL_NEAREST,
+            .wrap_s = GL_REPEAT,
+            .wrap_t = GL_REPEAT,
+            .internalformat = 4,
+            .format = 8,
+            .type = GL_UNSIGNED_BYTE,
+            .width = 1,
+            .height = 1,
+        };
+        t.create_texture(tc, rgba);
+        cache.emplace(key, t.ID);
+        return t.ID;
+    }
+
     glm::mat4x4 vec_to_glm_mat4x4(const std::vector<double> &mat)
     {
         if (mat.size() == 0)
@@ -0,0 +1,163 @@
+#include "frustum.hpp"
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_X86
+#include <immintrin.h>
+#endif
+
+void BoundsSoA::resize(size_t n)
+{
+    for (auto* v : {&center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z})
+        v->resize(n);
+}
+
+void BoundsSoA::set(size_t i, const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max)
+{
+    // Arvo: the center transforms as a point, the extent by the absolute of the linear part
+    const glm::vec3 c = (min + max) * 0.5f;
+    const glm::vec3 e = (max - min) * 0.5f;
+    const glm::vec4 wc = transform * glm::vec4(c, 1.0f);
+    glm::vec3 we{0.0f};
+    for (int col = 0; col < 3; col++) {
+        for (int row = 0; row < 3; row++)
+            we[row] += std::fabs(transform[col][row]) * e[col];
+    }
+
+    center_x[i] = wc.x;
+    center_y[i] = wc.y;
+    center_z[i] = wc.z;
+    extent_x[i] = we.x;
+    extent_y[i] = we.y;
+    extent_z[i] = we.z;
+}
+
+Frustum Frustum::from_matrix(const glm::mat4& PV)
+{
+    const auto row = [&](int r) { return glm::vec4(PV[0][r], PV[1][r], PV[2][r], PV[3][r]); };
+    Frustum f{};
+    f.planes[0] = row(3) + row(0); // left
+    f.planes[1] = row(3) - row(0); // right
+    f.planes[2] = row(3) + row(1); // bottom
+    f.planes[3] = row(3) - row(1); // top
+    f.planes[4] = row(3) + row(2); // near
+    f.planes[5] = row(3) - row(2); // far
+    for (auto& p : f.planes)
+        p /= glm::length(glm::vec3(p));
+    return f;
+}
+
+namespace {
+
+    // A box is outside a plane if even its corner furthest along the normal is behind it:
+    // dot(n, c) + dot(|n|, e) + d < 0.
+    void cull_scalar(const Frustum& f, const BoundsSoA& b, size_t begin, size_t end, uint8_t* visible)
+    {
+        for (size_t i = begin; i < end; i++) {
+            bool inside = true;
+            for (const auto& p : f.planes) {
+                const float dist = p.x * b.center_x[i] + p.y * b.center_y[i] + p.z * b.center_z[i] + p.w;
+                const float radius = std::fabs(p.x) * b.extent_x[i] + std::fabs(p.y) * b.extent_y[i] + std::fabs(p.z) * b.extent_z[i];
+                inside &= dist + radius >= 0.0f;
+            }
+            visible[i] = inside ? 1 : 0;
+        }
+    }
+
+#ifdef FRUSTUM_X86
+    bool has_avx2_fma()
+    {
+        static const bool avx2_fma = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return avx2_fma;
+    }
+
+    // Returns the first index it did not handle.
+    size_t cull_sse(const Frustum& f, const BoundsSoA& b, size_t begin, size_t end, uint8_t* visible)
+    {
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4) {
+            const __m128 cx = _mm_loadu_ps(b.center_x.data() + i);
+            const __m128 cy = _mm_loadu_ps(b.center_y.data() + i);
+            const __m128 cz = _mm_loadu_ps(b.center_z.data() + i);
+            const __m128 ex = _mm_loadu_ps(b.extent_x.data() + i);
+            const __m128 ey = _mm_loadu_ps(b.extent_y.data() + i);
+            const __m128 ez = _mm_loadu_ps(b.extent_z.data() + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const auto& p : f.planes) {
+                __m128 dist = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx), _mm_set1_ps(p.w));
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(p.y), cy));
+                dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(p.z), cz));
+                __m128 radius = _mm_mul_ps(_mm_set1_ps(std::fabs(p.x)), ex);
+                radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::fabs(p.y)), ey));
+                radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(std::fabs(p.z)), ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            for (int k = 0; k < 4; k++)
+                visible[i + k] = (mask >> k) & 1;
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2,fma")))
+    size_t cull_avx2(const Frustum& f, const BoundsSoA& b, size_t begin, size_t end, uint8_t* visible)
+    {
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            const __m256 cx = _mm256_loadu_ps(b.center_x.data() + i);
+            const __m256 cy = _mm256_loadu_ps(b.center_y.data() + i);
+            const __m256 cz = _mm256_loadu_ps(b.center_z.data() + i);
+            const __m256 ex = _mm256_loadu_ps(b.extent_x.data() + i);
+            const __m256 ey = _mm256_loadu_ps(b.extent_y.data() + i);
+            const __m256 ez = _mm256_loadu_ps(b.extent_z.data() + i);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const auto& p : f.planes) {
+                __m256 dist = _mm256_fmadd_ps(_mm256_set1_ps(p.x), cx, _mm256_set1_ps(p.w));
+                dist = _mm256_fmadd_ps(_mm256_set1_ps(p.y), cy, dist);
+                dist = _mm256_fmadd_ps(_mm256_set1_ps(p.z), cz, dist);
+                dist = _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(p.x)), ex, dist);
+                dist = _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(p.y)), ey, dist);
+                dist = _mm256_fmadd_ps(_mm256_set1_ps(std::fabs(p.z)), ez, dist);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+
+            // 0/-1 lanes -> 0/1 bytes
+            const __m256i bits = _mm256_srli_epi32(_mm256_castps_si256(inside), 31);
+            const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(visible + i), _mm_packus_epi16(words, words));
+        }
+        return i;
+    }
+#endif
+
+    void cull_range(const Frustum& f, const BoundsSoA& b, size_t begin, size_t end, uint8_t* visible)
+    {
+#ifdef FRUSTUM_X86
+        begin = has_avx2_fma() ? cull_avx2(f, b, begin, end, visible) : cull_sse(f, b, begin, end, visible);
+#endif
+        cull_scalar(f, b, begin, end, visible);
+    }
+
+} // end anonymous namespace
+
+void cull(const Frustum& frustum, const BoundsSoA& bounds, uint8_t* visible)
+{
+    const size_t count = bounds.size();
+    if (count < PARALLEL_CULL_THRESHOLD) {
+        cull_range(frustum, bounds, 0, count, visible);
+        return;
+    }
+
+    // chunks are a multiple of 8 so only the last one has a scalar tail
+    constexpr size_t CHUNK = 4096;
+    job_system().parallel_for((count + CHUNK - 1) / CHUNK, [&](size_t chunk) {
+        const size_t begin = chunk * CHUNK;
+        cull_range(frustum, bounds, begin, std::min(begin + CHUNK, count), visible);
+    });
+}
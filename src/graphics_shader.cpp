@@ -33,6 +33,7 @@ void GraphicsShader::compile(const std::vector<std::pair<GLenum, std::string>> &
 
     glLinkProgram(ID);
     check_compile_error(ID, "PROGRAM");
+    reflect_uniforms();
 
     for (GLuint shader : shaders)
     {
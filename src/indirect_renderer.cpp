@@ -0,0 +1,217 @@
+#include "indirect_renderer.hpp"
+#include "asset_manager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+static_assert(sizeof(IndirectRenderer::DrawElementsIndirectCommand) == 20);
+
+namespace draw_record_layout {
+    constexpr auto offsets = std430::offsets<uint32_t>();
+    constexpr size_t stride = std430::struct_size<uint32_t>();
+}; // end namespace 'draw_record_layout'
+static_assert(offsetof(IndirectRenderer::DrawRecord, material) == draw_record_layout::offsets[0]);
+static_assert(sizeof(IndirectRenderer::DrawRecord) == draw_record_layout::stride);
+
+IndirectRenderer::IndirectRenderer(const Shader& shader, MaterialBuffer& materials)
+    : shader(shader),
+      materials(materials),
+      u_base_color_texture(shader.uniform<int>("baseColorTexture")),
+      u_metallic_roughness_texture(shader.uniform<int>("metallicRoughnessTexture")),
+      u_draw_offset(shader.uniform<uint32_t>("u_DrawOffset"))
+{
+}
+
+void IndirectRenderer::draw(const glm::vec3& eye, const Frustum* frustum, const LodSelector* lod)
+{
+    materials.sync();
+
+    command_data.clear();
+    draw_data.clear();
+    instance_data.clear();
+    batches.clear();
+    transparent.clear();
+    frame_stats = Stats{};
+
+    const Material fallback{};
+    const auto material_of = [&](const AssetManager::Model::Primitive& p) -> const Material& {
+        return p.mat_idx >= 0 ? AssetManager::materials[p.mat_idx] : fallback;
+    };
+    const auto batch_key = [&](const AssetManager::Model::Primitive& p) {
+        const Material& m = material_of(p);
+        return std::tuple{m.double_sided, m.base_color_texture_idx, m.metallic_roughness_texture_idx, p.index_type};
+    };
+
+    for (const auto& model : AssetManager::models) {
+        if (frustum) {
+            visible.resize(model.instances.size());
+            cull(*frustum, model.bounds, visible.data());
+        }
+        const auto is_visible = [&](uint32_t instance) { return !frustum || visible[instance]; };
+
+        order.clear();
+        for (uint32_t i = 0; i < model.meshes.size(); i++) {
+            const auto& p = model.meshes[i];
+            if (p.count == 0)
+                continue;
+            if (material_of(p).mode == Material::AlphaMode::BLEND) {
+                // drawn after the opaque batches, see below
+                for (uint32_t k = p.first_instance; k < p.first_instance + p.instance_count; k++) {
+                    if (!is_visible(k)) {
+                        frame_stats.culled++;
+                        continue;
+                    }
+                    const glm::vec3 center(model.bounds.center_x[k], model.bounds.center_y[k], model.bounds.center_z[k]);
+                    transparent.push_back({glm::length(center - eye), &model, i, k});
+                }
+                continue;
+            }
+            bool any_visible = false;
+            for (uint32_t k = p.first_instance; k < p.first_instance + p.instance_count; k++)
+                any_visible |= is_visible(k);
+            if (any_visible)
+                order.push_back(i);
+            else
+                frame_stats.culled += p.instance_count;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return batch_key(model.meshes[a]) < batch_key(model.meshes[b]);
+        });
+
+        for (size_t n = 0; n < order.size(); n++) {
+            const auto& p = model.meshes[order[n]];
+            const Material& m = material_of(p);
+            if (n == 0 || batch_key(p) != batch_key(model.meshes[order[n - 1]])) {
+                batches.push_back(Batch{
+                    .VAO = model.geometry.VAO,
+                    .first_command = static_cast<uint32_t>(command_data.size()),
+                    .nof_commands = 0,
+                    .base_color_texture_idx = m.base_color_texture_idx,
+                    .metallic_roughness_texture_idx = m.metallic_roughness_texture_idx,
+                    .double_sided = m.double_sided,
+                    .base_color = m.base_color,
+                    .index_type = p.index_type,
+                });
+            }
+            // one command per level of detail the visible instances are drawn at
+            std::array<uint32_t, AssetManager::MAX_LODS + 1> level_counts{};
+            instance_levels.clear();
+            for (uint32_t k = p.first_instance; k < p.first_instance + p.instance_count; k++) {
+                if (!is_visible(k)) {
+                    frame_stats.culled++;
+                    continue;
+                }
+                const uint32_t level = lod ? lod->select(model, p, k) : 0;
+                instance_levels.push_back({k, level});
+                level_counts[level]++;
+            }
+            for (uint32_t level = 0; level <= p.nof_lods; level++) {
+                if (level_counts[level] == 0)
+                    continue;
+                const uint32_t first_instance = static_cast<uint32_t>(instance_data.size());
+                for (const auto& [instance, instance_level] : instance_levels) {
+                    if (instance_level == level)
+                        instance_data.push_back(model.instances[instance].model_matrix);
+                }
+                const auto range = p.lod(level);
+                command_data.push_back({range.count, level_counts[level], range.offset, p.base_vertex, first_instance});
+                draw_data.push_back(DrawRecord{materials.index_of(p.mat_idx)});
+                batches.back().nof_commands++;
+                frame_stats.triangles += uint64_t{range.count / 3} * level_counts[level];
+            }
+        }
+    }
+
+    // Blended instances get a command each, back to front over all models. A multi-draw executes its
+    // commands in order, so runs that share the batch state can still go in one call.
+    std::stable_sort(transparent.begin(), transparent.end(),
+                     [](const Transparent& a, const Transparent& b) { return a.distance > b.distance; });
+    for (size_t n = 0; n < transparent.size(); n++) {
+        const auto& t = transparent[n];
+        const auto& p = t.model->meshes[t.primitive];
+        const Material& m = material_of(p);
+        const bool same_batch = n > 0 && transparent[n - 1].model->geometry.VAO == t.model->geometry.VAO &&
+                                batch_key(transparent[n - 1].model->meshes[transparent[n - 1].primitive]) == batch_key(p);
+        if (!same_batch) {
+            batches.push_back(Batch{
+                .VAO = t.model->geometry.VAO,
+                .first_command = static_cast<uint32_t>(command_data.size()),
+                .nof_commands = 0,
+                .base_color_texture_idx = m.base_color_texture_idx,
+                .metallic_roughness_texture_idx = m.metallic_roughness_texture_idx,
+                .double_sided = m.double_sided,
+                .base_color = m.base_color,
+                .index_type = p.index_type,
+                .blend = true,
+            });
+        }
+        const auto range = p.lod(lod ? lod->select(*t.model, p, t.instance) : 0);
+        command_data.push_back({range.count, 1, range.offset, p.base_vertex, static_cast<uint32_t>(instance_data.size())});
+        instance_data.push_back(t.model->instances[t.instance].model_matrix);
+        draw_data.push_back(DrawRecord{materials.index_of(p.mat_idx)});
+        batches.back().nof_commands++;
+        frame_stats.triangles += range.count / 3;
+    }
+
+    frame_stats.draws = static_cast<uint32_t>(command_data.size());
+    frame_stats.instances = static_cast<uint32_t>(instance_data.size());
+    frame_stats.batches = static_cast<uint32_t>(batches.size());
+    if (batches.empty())
+        return;
+
+    draw_buffer.upload(draw_data.data(), draw_data.size() * sizeof(DrawRecord));
+    instance_buffer.upload(instance_data.data(), instance_data.size() * sizeof(glm::mat4));
+    command_buffer.upload(command_data.data(), command_data.size() * sizeof(DrawElementsIndirectCommand));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, draw_buffer.id());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, AssetManager::INSTANCE_BINDING, instance_buffer.id());
+
+    shader.use();
+    shader.set(u_base_color_texture, 0);
+    shader.set(u_metallic_roughness_texture, 1);
+
+    // whether a texture is sampled at all comes from the material's flags
+    const auto bind_texture = [&](int32_t idx, GLenum unit, const glm::vec4& placeholder) {
+        if (idx == -1)
+            return;
+        const uint32_t id = AssetManager::textures[idx].acquire();
+        glActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, id != 0 ? id : AssetManager::placeholder_texture(placeholder));
+        frame_stats.texture_binds++;
+    };
+
+    GLuint bound_vao = 0;
+    bool blending = false;
+    for (const auto& b : batches) {
+        if (b.VAO != bound_vao) {
+            glBindVertexArray(b.VAO);
+            bound_vao = b.VAO;
+        }
+
+        // white keeps the metallic/roughness factors unchanged
+        bind_texture(b.base_color_texture_idx, GL_TEXTURE0, b.base_color);
+        bind_texture(b.metallic_roughness_texture_idx, GL_TEXTURE1, glm::vec4(1.0f));
+        shader.set(u_draw_offset, b.first_command);
+
+        // blended batches come last; they are depth tested against the opaque ones but do not
+        // occlude each other, as in RenderQueue
+        if (b.blend && !blending) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
+        if (b.double_sided)
+            glDisable(GL_CULL_FACE);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, b.index_type,
+                                    (void*)(b.first_command * sizeof(DrawElementsIndirectCommand)), b.nof_commands, 0);
+        if (b.double_sided)
+            glEnable(GL_CULL_FACE);
+    }
+
+    if (blending) {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,133 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+
+// index of the pool queue owned by the current thread, SIZE_MAX for non-workers
+static thread_local size_t current_worker = SIZE_MAX;
+static thread_local const JobSystem* current_pool = nullptr;
+
+JobSystem::JobSystem(size_t nof_workers)
+{
+    if (nof_workers == 0)
+        nof_workers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < nof_workers; i++)
+        queues.push_back(std::make_unique<Queue>());
+
+    for (size_t i = 0; i < nof_workers; i++)
+        threads.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+void JobSystem::submit(Job job)
+{
+    const size_t idx = current_pool == this
+        ? current_worker
+        : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    // count the job before it becomes visible so 'pending' never underflows
+    {
+        std::lock_guard lock(sleep_mutex);
+        pending++;
+    }
+
+    {
+        std::lock_guard lock(queues[idx]->mutex);
+        queues[idx]->jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+bool JobSystem::try_pop(size_t queue_idx, Job& job)
+{
+    auto& q = *queues[queue_idx];
+    std::lock_guard lock(q.mutex);
+    if (q.jobs.empty())
+        return false;
+    job = std::move(q.jobs.back());
+    q.jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::try_steal(size_t thief_idx, Job& job)
+{
+    const size_t n = queues.size();
+    for (size_t k = 1; k <= n; k++) {
+        auto& q = *queues[(thief_idx + k) % n];
+        std::lock_guard lock(q.mutex);
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JobSystem::run_one()
+{
+    Job job;
+    const bool own = current_pool == this;
+    if ((own && try_pop(current_worker, job)) || try_steal(own ? current_worker : 0, job)) {
+        pending--;
+        job();
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::worker_loop(size_t idx)
+{
+    current_worker = idx;
+    current_pool = this;
+
+    while (true) {
+        if (run_one())
+            continue;
+
+        std::unique_lock lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || pending > 0; });
+        if (stopping && pending == 0)
+            return;
+    }
+}
+
+void JobSystem::parallel_for(size_t count, const std::function<void(size_t)>& fn, size_t grain)
+{
+    if (count == 0)
+        return;
+
+    grain = std::max<size_t>(grain, 1);
+    const size_t nof_chunks = (count + grain - 1) / grain;
+    std::atomic<size_t> remaining{nof_chunks};
+
+    for (size_t c = 0; c < nof_chunks; c++) {
+        submit([&, c] {
+            const size_t end = std::min(count, (c + 1) * grain);
+            for (size_t i = c * grain; i < end; i++)
+                fn(i);
+            remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        if (!run_one())
+            std::this_thread::yield();
+    }
+}
+
+JobSystem& job_system()
+{
+    static JobSystem pool{};
+    return pool;
+}
@@ -0,0 +1,270 @@
+#include "load_stats.hpp"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+const char* to_string(LoadStage stage)
+{
+    switch (stage) {
+        case LoadStage::FILE_READ: return "file_read";
+        case LoadStage::JSON_PARSE: return "json_parse";
+        case LoadStage::BUFFER_DECODE: return "buffer_decode";
+        case LoadStage::IMAGE_DECODE: return "image_decode";
+        case LoadStage::MESH_UPLOAD: return "mesh_upload";
+        case LoadStage::TEXTURE_UPLOAD: return "texture_upload";
+        case LoadStage::TRANSFORM_BUILD: return "transform_build";
+        default: return "unknown";
+    }
+}
+
+void print_load_stats(const std::string& name, const LoadStats& stats)
+{
+    printf("Loaded '%s' in %.2f ms (%.2f MiB%s, peak heap +%.2f MiB)\n", name.c_str(), stats.total_ms,
+        stats.file_bytes / (1024.0 * 1024.0), stats.from_cache ? ", from cache" : "",
+        stats.peak_alloc_bytes / (1024.0 * 1024.0));
+    if (stats.from_cache)
+        return;
+
+    for (size_t i = 0; i < NOF_LOAD_STAGES; i++) {
+        const auto& s = stats.stages[i];
+        printf("  %-16s %9.2f ms %10.2f MiB  peak +%.2f MiB\n", to_string(static_cast<LoadStage>(i)), s.ms,
+            s.bytes / (1024.0 * 1024.0), s.peak_alloc_bytes / (1024.0 * 1024.0));
+    }
+
+    const auto& w = stats.weld;
+    if (w.vertices_before > 0) {
+        printf("  vertex weld      %llu -> %llu vertices, %.1f%% fewer (%.2f ms welding)\n",
+            static_cast<unsigned long long>(w.vertices_before), static_cast<unsigned long long>(w.vertices_after),
+            100.0 * w.reduction(), w.weld_ms);
+    }
+
+    const auto& l = stats.lods;
+    if (l.triangles > 0) {
+        printf("  levels of detail %llu levels on %llu meshes, %llu -> %llu triangles, %.1f%% fewer (%.2f ms simplifying)\n",
+            static_cast<unsigned long long>(l.levels), static_cast<unsigned long long>(l.meshes_with_lods),
+            static_cast<unsigned long long>(l.triangles), static_cast<unsigned long long>(l.coarsest_triangles),
+            100.0 * l.reduction(), l.lod_ms);
+    }
+
+    const auto& vc = stats.vertex_cache;
+    if (vc.triangles > 0) {
+        printf("  vertex cache     ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%.2f ms optimizing)\n",
+            vc.acmr_before(), vc.acmr_after(), vc.atvr_before(), vc.atvr_after(), vc.optimize_ms);
+    }
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& o)
+{
+    triangles += o.triangles;
+    vertices += o.vertices;
+    transformed_before += o.transformed_before;
+    transformed_after += o.transformed_after;
+    optimize_ms += o.optimize_ms;
+    return *this;
+}
+
+WeldStats& WeldStats::operator+=(const WeldStats& o)
+{
+    vertices_before += o.vertices_before;
+    vertices_after += o.vertices_after;
+    weld_ms += o.weld_ms;
+    return *this;
+}
+
+LodStats& LodStats::operator+=(const LodStats& o)
+{
+    meshes_with_lods += o.meshes_with_lods;
+    levels += o.levels;
+    triangles += o.triangles;
+    coarsest_triangles += o.coarsest_triangles;
+    lod_ms += o.lod_ms;
+    return *this;
+}
+
+/*
+ * Heap accounting
+ */
+
+namespace alloc_stats {
+
+    static std::atomic<int64_t> live{0};
+    static std::atomic<int64_t> peak{0};
+    static std::atomic<uint32_t> counting{0};
+
+    static void on_alloc(void* ptr)
+    {
+        if (ptr == nullptr || counting.load(std::memory_order_relaxed) == 0)
+            return;
+        const int64_t size = static_cast<int64_t>(malloc_usable_size(ptr));
+        const int64_t now = live.fetch_add(size, std::memory_order_relaxed) + size;
+        int64_t seen = peak.load(std::memory_order_relaxed);
+        while (now > seen && !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+    }
+
+    static void on_free(void* ptr)
+    {
+        if (ptr != nullptr && counting.load(std::memory_order_relaxed) != 0)
+            live.fetch_sub(malloc_usable_size(ptr), std::memory_order_relaxed);
+    }
+
+    void begin_counting()
+    {
+        // blocks from before counting are unknown, frees of them drive 'live' below zero
+        if (counting.fetch_add(1, std::memory_order_relaxed) == 0) {
+            live.store(0, std::memory_order_relaxed);
+            peak.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void end_counting()
+    {
+        counting.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    uint64_t live_bytes()
+    {
+        return static_cast<uint64_t>(std::max<int64_t>(live.load(std::memory_order_relaxed), 0));
+    }
+
+    uint64_t take_peak()
+    {
+        const int64_t p = peak.exchange(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return static_cast<uint64_t>(std::max<int64_t>(p, 0));
+    }
+
+    void* counted_malloc(size_t size)
+    {
+        void* ptr = std::malloc(size);
+        on_alloc(ptr);
+        return ptr;
+    }
+
+    void* counted_realloc(void* ptr, size_t size)
+    {
+        on_free(ptr);
+        void* out = std::realloc(ptr, size);
+        // a failed realloc leaves the old block alive
+        on_alloc(out != nullptr ? out : (size != 0 ? ptr : nullptr));
+        return out;
+    }
+
+    void* counted_aligned_alloc(size_t alignment, size_t size)
+    {
+        void* ptr = std::aligned_alloc(alignment, size);
+        on_alloc(ptr);
+        return ptr;
+    }
+
+    void counted_free(void* ptr)
+    {
+        on_free(ptr);
+        std::free(ptr);
+    }
+
+}; // end namespace 'alloc_stats'
+
+/*
+ * LoadTracker
+ */
+
+LoadTracker::LoadTracker(LoadStats* stats, const ProgressCallback* progress)
+    : stats(stats), progress(progress != nullptr && *progress ? progress : nullptr)
+{
+    // only LoadStats reports allocations
+    if (stats != nullptr) {
+        alloc_stats::begin_counting();
+        baseline = alloc_stats::live_bytes();
+    }
+    alloc_stats::take_peak();
+}
+
+LoadTracker::~LoadTracker()
+{
+    if (stats != nullptr)
+        alloc_stats::end_counting();
+}
+
+void LoadTracker::fold_peak()
+{
+    const uint64_t p = alloc_stats::take_peak();
+    const uint64_t above = p > baseline ? p - baseline : 0;
+    overall_peak = std::max(overall_peak, above);
+    for (auto& w : windows) {
+        if (w.open)
+            w.peak = std::max(w.peak, above);
+    }
+}
+
+void LoadTracker::begin(LoadStage stage)
+{
+    if (!active())
+        return;
+    fold_peak();
+    auto& w = windows[static_cast<size_t>(stage)];
+    w.open = true;
+    w.start = Clock::now();
+    const uint64_t live = alloc_stats::live_bytes();
+    w.peak = std::max(w.peak, live > baseline ? live - baseline : 0);
+}
+
+void LoadTracker::end(LoadStage stage, uint64_t bytes, double exclude_ms)
+{
+    if (!active())
+        return;
+    fold_peak();
+    auto& w = windows[static_cast<size_t>(stage)];
+    auto& s = local[static_cast<size_t>(stage)];
+    if (w.open)
+        s.ms += std::max(0.0, std::chrono::duration<double, std::milli>(Clock::now() - w.start).count() - exclude_ms);
+    s.bytes += bytes;
+    s.peak_alloc_bytes = std::max(s.peak_alloc_bytes, w.peak);
+    w.open = false;
+}
+
+void LoadTracker::set_total(uint64_t file_bytes)
+{
+    bytes_total = file_bytes;
+}
+
+void LoadTracker::advance(LoadStage stage, uint64_t source_bytes)
+{
+    bytes_done = std::min(bytes_total, bytes_done + source_bytes);
+    report(stage);
+}
+
+void LoadTracker::report(LoadStage stage)
+{
+    if (progress == nullptr)
+        return;
+    LoadProgress p{};
+    p.stage = stage;
+    p.bytes_done = bytes_done;
+    p.bytes_total = bytes_total;
+    p.elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    p.bytes_per_sec = p.elapsed_ms > 0.0 ? bytes_done / (p.elapsed_ms / 1000.0) : 0.0;
+    (*progress)(p);
+}
+
+void LoadTracker::finish(bool from_cache)
+{
+    if (!active())
+        return;
+    fold_peak();
+    bytes_done = bytes_total;
+    report(LoadStage::TRANSFORM_BUILD);
+
+    if (stats == nullptr)
+        return;
+    stats->stages = local;
+    stats->vertex_cache = vertex_cache;
+    stats->weld = weld;
+    stats->lods = lods;
+    stats->total_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    stats->file_bytes = bytes_total;
+    stats->peak_alloc_bytes = overall_peak;
+    stats->from_cache = from_cache;
+}
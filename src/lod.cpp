@@ -0,0 +1,39 @@
+#include "lod.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+LodSelector LodSelector::from_camera(const Camera& camera, float max_pixel_error)
+{
+    LodSelector selector{};
+    selector.eye = camera.origin;
+    selector.pixels_per_unit = camera.viewport_height / (2.0f * std::tan(glm::radians(camera.vertical_fov) * 0.5f));
+    selector.near_plane = camera.near_plane;
+    selector.max_pixel_error = max_pixel_error;
+    return selector;
+}
+
+uint32_t LodSelector::select(const AssetManager::Model& model, const AssetManager::Model::Primitive& primitive,
+                             uint32_t instance) const
+{
+    if (primitive.nof_lods == 0)
+        return 0;
+
+    // the world space bounds are an AABB around the transformed object space box, its
+    // circumscribed sphere holds every vertex
+    const glm::vec3 center(model.bounds.center_x[instance], model.bounds.center_y[instance], model.bounds.center_z[instance]);
+    const glm::vec3 extent(model.bounds.extent_x[instance], model.bounds.extent_y[instance], model.bounds.extent_z[instance]);
+    const float distance = std::max(glm::length(center - eye) - glm::length(extent), near_plane);
+
+    // errors are object space, non-uniform scales stretch them by at most the largest axis
+    const glm::mat4& transform = model.instances[instance].model_matrix;
+    const float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                                  glm::length(glm::vec3(transform[2]))});
+    const float pixels_per_error = scale * pixels_per_unit / distance;
+
+    // every level is at least as far off the full detail surface as the one before
+    uint32_t level = 0;
+    while (level < primitive.nof_lods && primitive.lods[level].error * pixels_per_error <= max_pixel_error)
+        level++;
+    return level;
+}
@@ -10,11 +10,24 @@
 #include "asset_manager.hpp"
 #include "graphics_shader.hpp"
 #include "camera.hpp"
+#include "indirect_renderer.hpp"
+#include "material_buffer.hpp"
 #include "mesh.hpp"
+#include "render_queue.hpp"
 
 GLFWwindow* window;
 constexpr int WINDOW_WIDTH = 1280;
 constexpr int WINDOW_HEIGHT = 1024;
+// toggled with 'I': draw through IndirectRenderer instead of one glDrawElements per primitive
+bool indirect_rendering = false;
+bool report_indirect_stats = false;
+bool lod_selection = true;
+// 'U' prints and resets the uniform update counters of both shaders
+bool report_uniform_stats = false;
+// 'Q' prints the render queue's state changes with and without sorting
+bool report_queue_stats = false;
+// 'C' toggles frustum culling of primitives
+bool frustum_culling = true;
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
@@ -33,6 +46,7 @@ int main()
     camera.origin = { 0.0f, 0.0f, 5.0f };
 	camera.vertical_fov = 45.0f;
 	camera.aspect_ratio = static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT);
+    camera.viewport_height = static_cast<float>(WINDOW_HEIGHT);
 	camera.near_plane = 0.001f;
 	camera.far_plane = 150.0f;
     camera.movement_speed = 15.0f;
@@ -41,27 +55,44 @@ int main()
 
     GraphicsShader shader("default.vert", "default.frag");
     shader.use();
-
-    //if (!AssetManager::load_model("mazda_rx-7.glb", AssetManager::FILE_FORMAT::GLB)) {
-    //if (!AssetManager::load_model("lamborghini_diablo_sv.glb", AssetManager::FILE_FORMAT::GLB)) {
-    //if (!AssetManager::load_model("sponza.glb", AssetManager::FILE_FORMAT::GLB)) {
-    //if (!AssetManager::load_model("ship_x_sail_opaque.glb", AssetManager::FILE_FORMAT::GLB)) {
-    if (!AssetManager::load_model("2006_apr_lancer_evolution_ix_gsr_tokyo_drift.glb", AssetManager::FILE_FORMAT::GLB)) {
+    GraphicsShader indirect_shader("indirect.vert", "indirect.frag");
+    MaterialBuffer material_buffer{};
+    IndirectRenderer indirect_renderer(indirect_shader, material_buffer);
+    RenderQueue render_queue{};
+    const uint8_t default_pipeline = render_queue.add_pipeline(shader);
+
+    // resolved once, see Shader::uniform()
+    const auto u_PV = shader.uniform<glm::mat4>("u_PV");
+    const auto u_CameraPosition = shader.uniform<glm::vec3>("u_CameraPosition");
+    const auto u_IndirectPV = indirect_shader.uniform<glm::mat4>("u_PV");
+    const auto u_IndirectCameraPosition = indirect_shader.uniform<glm::vec3>("u_CameraPosition");
+
+    LoadStats load_stats{};
+    // the LOD chain is simplified once and read back from the .gltfcache afterwards
+    const AssetManager::LoadOptions load_options{.use_cache = true, .lod_levels = 4, .stats = &load_stats};
+    //const char* model_name = "mazda_rx-7.glb";
+    //const char* model_name = "lamborghini_diablo_sv.glb";
+    //const char* model_name = "sponza.glb";
+    //const char* model_name = "ship_x_sail_opaque.glb";
+    const char* model_name = "2006_apr_lancer_evolution_ix_gsr_tokyo_drift.glb";
+    if (!AssetManager::load_model(model_name, AssetManager::FILE_FORMAT::GLB, load_options)) {
         printf("Failed to load model :(\n");
         return EXIT_FAILURE;
     }
+    print_load_stats(model_name, load_stats);
 
     /*
-    for (auto& [_, model] : AssetManager::models){
-        for (auto& mesh : model.meshes) {
-            mesh.model_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(100.0f)) * mesh.model_matrix;
+    for (auto& model : AssetManager::models){
+        for (uint32_t n = 0; n < model.nodes.size(); n++) {
+            if (model.nodes.parent[n] == TransformHierarchy::NO_PARENT)
+                model.nodes.set_local(n, glm::scale(glm::mat4(1.0f), glm::vec3(100.0f)) * model.nodes.local[n]);
         }
     }
     */
 
     /*
     printf("nof_mats = %zu\n", AssetManager::materials.size());
-    for (const auto& [_, model] : AssetManager::models) {
+    for (const auto& model : AssetManager::models) {
         printf("nof_meshes = %zu\n", model.meshes.size());
         for (const auto& mesh : model.meshes) {
             printf("mat_idx = %d\n", mesh.mat_idx);
@@ -93,58 +124,64 @@ int main()
 		deltatime = current_frame - last_frame;
 		last_frame = current_frame;
 
+        // only nodes edited since the last frame are recomputed
+        for (auto& model : AssetManager::models)
+            AssetManager::update_transforms(model);
+
         const auto P = camera.projection_matrix;
         const auto V = camera.get_view_matrix();
         const auto PV = P * V;
+        const Frustum frustum = Frustum::from_matrix(PV);
+        const Frustum* culling = frustum_culling ? &frustum : nullptr;
+        const LodSelector lod_selector = LodSelector::from_camera(camera);
+        const LodSelector* lod = lod_selection ? &lod_selector : nullptr;
 
-        shader.set_mat4("u_PV", PV);
-        shader.set_vec3("u_CameraPosition", camera.origin);
-        
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        shader.use();
-        for (const auto& [_, model] : AssetManager::models) {
-            for (const auto& mesh : model.meshes) {
-                shader.set_mat4("u_ModelMatrix", mesh.model_matrix);
-
-                if (mesh.mat_idx != -1) {
-                    const auto& mat = AssetManager::materials[mesh.mat_idx];
-                    if (mat.base_color_texture_idx != -1) {
-                        const auto& tex = AssetManager::textures[mat.base_color_texture_idx];
-                        glActiveTexture(GL_TEXTURE0);
-                        glBindTexture(GL_TEXTURE_2D, tex.ID);
-                        shader.set_int("baseColorTexture", 0);
-                        shader.set_int("hasBaseColorTexture", 1);
-                    } else {
-                        shader.set_int("hasBaseColorTexture", 0);
-                    }
-                    if (mat.metallic_roughness_texture_idx != -1) {
-                        const auto& tex = AssetManager::textures[mat.metallic_roughness_texture_idx];
-                        glActiveTexture(GL_TEXTURE1);
-                        glBindTexture(GL_TEXTURE_2D, tex.ID);
-                        shader.set_int("metallicRoughnessTexture", 1);
-                        shader.set_int("hasMetallicRoughnessTexture", 1);
-                    } else {
-                        shader.set_int("hasMetallicRoughnessTexture", 0);
-                    }
-
-                    shader.set_vec4("mat.base_color", mat.base_color);
-                    shader.set_float("mat.metalness", mat.metalness);
-                    shader.set_float("mat.roughness", mat.roughness);
-
-                    if (mat.double_sided) {
-                        glDisable(GL_CULL_FACE);
-                    }
-
-                }
-
-                glBindVertexArray(mesh.VAO);
-                glDrawElements(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, (void*)(mesh.offset * sizeof(uint32_t)));
+        if (indirect_rendering) {
+            indirect_shader.set(u_IndirectPV, PV);
+            indirect_shader.set(u_IndirectCameraPosition, camera.origin);
+            indirect_renderer.draw(camera.origin, culling, lod);
+            if (report_indirect_stats) {
+                const auto& stats = indirect_renderer.stats();
+                printf("Indirect: %u draws of %u instances (%u culled) in %u multi-draw calls, %u texture binds, %llu triangles\n",
+                    stats.draws, stats.instances, stats.culled, stats.batches, stats.texture_binds,
+                    static_cast<unsigned long long>(stats.triangles));
+                report_indirect_stats = false;
+            }
+        } else {
+            shader.set(u_PV, PV);
+            shader.set(u_CameraPosition, camera.origin);
+            material_buffer.sync();
+
+            render_queue.begin(V, camera.far_plane);
+            for (const auto& model : AssetManager::models)
+                render_queue.push(model, default_pipeline, material_buffer, culling, lod);
+            render_queue.sort();
+            render_queue.submit();
+
+            if (report_queue_stats) {
+                const auto& stats = render_queue.stats();
+                const auto print = [](const char* label, const RenderQueue::StateChanges& c) {
+                    printf("  %-8s %6u total: %u programs, %u VAOs, %u textures, %u materials, %u cull, %u blend\n",
+                        label, c.total(), c.programs, c.vaos, c.textures, c.materials, c.cull, c.blend);
+                };
+                printf("Render queue: %u packets of %u instances (%u culled), %llu triangles, state changes\n",
+                    stats.packets, stats.instances, stats.culled, static_cast<unsigned long long>(stats.triangles));
+                print("unsorted", stats.unsorted);
+                print("sorted", stats.sorted);
+                report_queue_stats = false;
+            }
+        }
 
-                if (mesh.mat_idx != -1 && AssetManager::materials[mesh.mat_idx].double_sided) {
-                    glEnable(GL_CULL_FACE);
-                }
+        if (report_uniform_stats) {
+            for (const auto& [label, s] : {std::pair{"default", &shader}, std::pair{"indirect", &indirect_shader}}) {
+                const auto& stats = s->uniform_stats();
+                printf("Uniforms (%s): %llu updates, %llu elided\n", label,
+                    static_cast<unsigned long long>(stats.updates), static_cast<unsigned long long>(stats.elided));
+                s->reset_uniform_stats();
             }
+            report_uniform_stats = false;
         }
 
         //render_test_triangle(shader);
@@ -179,6 +216,7 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height)
     glViewport(0, 0, width, height);
     Camera* camera = static_cast<Camera*>(glfwGetWindowUserPointer(window));
     camera->aspect_ratio = static_cast<float>(width) / static_cast<float>(height);
+    camera->viewport_height = static_cast<float>(height);
     camera->update_projection_matrix();
 }
 
@@ -192,6 +230,28 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         wireframe_mode = !wireframe_mode;
         glPolygonMode(GL_FRONT_AND_BACK, wireframe_mode ? GL_LINE : GL_FILL);
     }
+
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        indirect_rendering = !indirect_rendering;
+        report_indirect_stats = indirect_rendering;
+        printf("Indirect rendering %s.\n", indirect_rendering ? "on" : "off");
+    }
+
+    if (key == GLFW_KEY_U && action == GLFW_PRESS)
+        report_uniform_stats = true;
+
+    if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+        report_queue_stats = true;
+
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        frustum_culling = !frustum_culling;
+        printf("Frustum culling %s.\n", frustum_culling ? "on" : "off");
+    }
+
+    if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        lod_selection = !lod_selection;
+        printf("Level of detail selection %s.\n", lod_selection ? "on" : "off");
+    }
 }
 
 void mouse_callback(GLFWwindow *window, double xpos, double ypos)
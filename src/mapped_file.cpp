@@ -0,0 +1,70 @@
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)),
+      mapping_size(std::exchange(other.mapping_size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::filesystem::path& path)
+{
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printf("Failed to open '%s' for mapping.\n", path.c_str());
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("Failed to stat '%s' or file is empty.\n", path.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (addr == MAP_FAILED) {
+        printf("Failed to map '%s'.\n", path.c_str());
+        return false;
+    }
+
+    mapping = static_cast<const unsigned char*>(addr);
+    mapping_size = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mapping != nullptr) {
+        munmap(const_cast<unsigned char*>(mapping), mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+}
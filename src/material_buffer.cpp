@@ -0,0 +1,37 @@
+#include "material_buffer.hpp"
+#include "asset_manager.hpp"
+
+#include <algorithm>
+
+MaterialBuffer::MaterialBuffer()
+{
+    glGenBuffers(1, &ID);
+}
+
+MaterialBuffer::~MaterialBuffer()
+{
+    glDeleteBuffers(1, &ID);
+}
+
+void MaterialBuffer::sync()
+{
+    // the global array only grows or gets cleared, its size tells whether it changed
+    const auto& source = AssetManager::materials;
+    if (dirty || source.size() != uploaded) {
+        records.resize(source.size() + 1);
+        for (size_t i = 0; i < source.size(); i++)
+            records[i] = GpuMaterial::from(source[i]);
+        records.back() = GpuMaterial::from(Material{});
+
+        const size_t size = records.size() * sizeof(GpuMaterial);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+        if (size > capacity) {
+            capacity = std::max(size, capacity * 2);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, records.data());
+        uploaded = source.size();
+        dirty = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, ID);
+}
@@ -1,25 +1,19 @@
 #include "mesh.hpp"
+#include "accessor.hpp"
+#include "load_stats.hpp"
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
+// route image decoder allocations through the heap accounting (LoadStats::peak_alloc_bytes)
+#define STBI_MALLOC(size) alloc_stats::counted_malloc(size)
+#define STBI_REALLOC(ptr, size) alloc_stats::counted_realloc(ptr, size)
+#define STBI_FREE(ptr) alloc_stats::counted_free(ptr)
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "tiny_gltf.h"
 
 #include <filesystem>
 #include <assert.h>
 
-static const auto to_glm_vec3 = [](const float* data, const size_t size, std::vector<glm::vec3>& out) -> void {
-    out.reserve(size);
-    for (size_t i = 0; i < size * 3; i += 3)
-        out.emplace_back(data[i + 0], data[i + 1], data[i + 2]);
-};
-
-static const auto to_glm_vec2 = [](const float* data, const size_t size, std::vector<glm::vec2>& out) -> void {
-    out.reserve(size);
-    for (size_t i = 0; i < size * 3; i += 2)
-        out.emplace_back(data[i + 0], data[i + 1]);
-};
-
 Mesh::Mesh()
 {
 }
@@ -57,103 +51,81 @@ bool Mesh::load_mesh(const char *filename)
         return -1;
     }
 
-    const auto to_glm_vec3 = [](const float* data, const size_t size, std::vector<glm::vec3>& out) -> void {
-        out.reserve(size);
-        for (size_t i = 0; i < size * 3; i += 3)
-            out.emplace_back(data[i + 0], data[i + 1], data[i + 2]);
-    };
-
-    const auto to_glm_vec2 = [](const float* data, const size_t size, std::vector<glm::vec2>& out) -> void {
-        out.reserve(size);
-        for (size_t i = 0; i < size * 3; i += 2)
-            out.emplace_back(data[i + 0], data[i + 1]);
-    };
-
-    std::vector<glm::vec3> positions{};
-    std::vector<glm::vec3> normals{};
-    std::vector<glm::vec2> texCoords{};
-
-    uint32_t nof_indices = 0;
-    for (const auto& mesh : model.meshes) {
-        for (const auto& primitive : mesh.primitives) {
-            const auto& acc_ind = model.accessors[primitive.indices];
-            nof_indices += acc_ind.count;
-        }
-    }
-    printf("Found %d indices\n", nof_indices);
-
-    std::vector<uint32_t> indices{};
-    indices.reserve(nof_indices);
+    accessor::BufferSpans buffers{};
+    for (const auto& buffer : model.buffers)
+        buffers.emplace_back(buffer.data);
 
     meshes.resize(model.meshes.size());
 
     for (size_t i = 0; i < model.meshes.size(); i++) {
         const auto& mesh = model.meshes[i];
 
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec2> texCoords;
-        std::vector<uint32_t> indices;
+        size_t nof_vertices = 0;
+        size_t nof_indices = 0;
+        bool has_normals = false;
+        bool has_tex_coords = false;
+        for (const auto& primitive : mesh.primitives) {
+            const auto it_pos = primitive.attributes.find("POSITION");
+            if (it_pos == primitive.attributes.end())
+                continue;
+            nof_vertices += model.accessors[it_pos->second].count;
+            if (primitive.indices >= 0)
+                nof_indices += model.accessors[primitive.indices].count;
+            has_normals |= primitive.attributes.contains("NORMAL");
+            has_tex_coords |= primitive.attributes.contains("TEXCOORD_0");
+        }
+
+        std::vector<glm::vec3> positions(nof_vertices);
+        std::vector<glm::vec3> normals(has_normals ? nof_vertices : 0);
+        std::vector<glm::vec2> texCoords(has_tex_coords ? nof_vertices : 0);
+        std::vector<uint32_t> indices(nof_indices);
 
         uint32_t index_offset = 0;
+        uint32_t vertex_offset = 0;
 
         for (const auto& primitive : mesh.primitives) {
-            if (primitive.attributes.find("POSITION") != primitive.attributes.end()) {
-                const auto& acc_pos = model.accessors[primitive.attributes.at("POSITION")];
-                const auto& bv_pos = model.bufferViews[acc_pos.bufferView];
-                const auto& buffer = model.buffers[bv_pos.buffer];
-                const float* data_pos = reinterpret_cast<const float*>(&buffer.data[bv_pos.byteOffset + acc_pos.byteOffset]);
-                to_glm_vec3(data_pos, acc_pos.count, positions);
-            }
-
-            if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-                const auto& acc_norm = model.accessors[primitive.attributes.at("NORMAL")];
-                const auto& bv_norm = model.bufferViews[acc_norm.bufferView];
-                const auto& buffer = model.buffers[bv_norm.buffer];
-                const float* data_norm = reinterpret_cast<const float*>(&buffer.data[bv_norm.byteOffset + acc_norm.byteOffset]);
-                to_glm_vec3(data_norm, acc_norm.count, normals);
-            }
-
-            if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-                const auto& acc_tc = model.accessors[primitive.attributes.at("TEXCOORD_0")];
-                const auto& bv_tc = model.bufferViews[acc_tc.bufferView];
-                const auto& buffer = model.buffers[bv_tc.buffer];
-                const float* data_tc = reinterpret_cast<const float*>(&buffer.data[bv_tc.byteOffset + acc_tc.byteOffset]);
-                to_glm_vec2(data_tc, acc_tc.count, texCoords);
+            const auto it_pos = primitive.attributes.find("POSITION");
+            if (it_pos == primitive.attributes.end())
+                continue;
+
+            accessor::View pos{}, norm{}, tc{};
+            if (!accessor::make_view(model, buffers, model.accessors[it_pos->second], pos))
+                return false;
+
+            const auto it_norm = primitive.attributes.find("NORMAL");
+            const bool prim_has_normals = it_norm != primitive.attributes.end();
+            if (prim_has_normals && !accessor::make_view(model, buffers, model.accessors[it_norm->second], norm))
+                return false;
+
+            const auto it_tc = primitive.attributes.find("TEXCOORD_0");
+            const bool prim_has_tex_coords = it_tc != primitive.attributes.end();
+            if (prim_has_tex_coords && !accessor::make_view(model, buffers, model.accessors[it_tc->second], tc))
+                return false;
+
+            if (!accessor::read_vertices(
+                    pos,
+                    prim_has_normals ? &norm : nullptr,
+                    prim_has_tex_coords ? &tc : nullptr,
+                    positions.data() + vertex_offset,
+                    prim_has_normals ? normals.data() + vertex_offset : nullptr,
+                    prim_has_tex_coords ? texCoords.data() + vertex_offset : nullptr)) {
+                return false;
             }
 
-            // Handling indices correctly
             if (primitive.indices >= 0) {
-                const auto& acc_ind = model.accessors[primitive.indices];
-                const auto& bv_ind = model.bufferViews[acc_ind.bufferView];
-                const auto& buffer = model.buffers[bv_ind.buffer];
-
-                switch(acc_ind.componentType) {
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                        indices.insert(indices.end(),
-                            reinterpret_cast<const GLubyte*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                            reinterpret_cast<const GLubyte*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                        indices.insert(indices.end(),
-                            reinterpret_cast<const GLushort*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                            reinterpret_cast<const GLushort*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                        break;
-                    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                        indices.insert(indices.end(),
-                            reinterpret_cast<const GLuint*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]),
-                            reinterpret_cast<const GLuint*>(&buffer.data[bv_ind.byteOffset + acc_ind.byteOffset]) + acc_ind.count);
-                        break;
-                    default:
-                        printf("Unsupported index component type %d\n", acc_ind.componentType);
-                        return false;
-                }
+                accessor::View ind{};
+                if (!accessor::make_view(model, buffers, model.accessors[primitive.indices], ind))
+                    return false;
+                if (!accessor::read_indices(ind, vertex_offset, indices.data() + index_offset))
+                    return false;
+                index_offset += ind.count;
             }
+
+            vertex_offset += pos.count;
         }
 
-        meshes[i].offset = index_offset;
+        meshes[i].offset = 0;
         meshes[i].count = indices.size();
-        index_offset += indices.size();
 
         glGenVertexArrays(1, &meshes[i].VAO);
         glBindVertexArray(meshes[i].VAO);
@@ -0,0 +1,788 @@
+#include "mesh_optimizer.hpp"
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    // FIFO post-transform cache that can be flushed in constant time
+    struct FifoCache {
+        // a vertex is cached while fewer than 'size' misses happened since it entered
+        std::vector<uint64_t> entered;
+        uint64_t clock;
+        uint32_t size;
+
+        FifoCache(size_t nof_vertices, uint32_t cache_size)
+            : entered(nof_vertices, 0), clock(cache_size + 1), size(cache_size) {}
+
+        // 1 on a miss
+        uint32_t access(uint32_t v)
+        {
+            if (clock - entered[v] <= size)
+                return 0;
+            entered[v] = clock++;
+            return 1;
+        }
+        uint32_t access(const uint32_t* triangle) { return access(triangle[0]) + access(triangle[1]) + access(triangle[2]); }
+        void flush() { clock += size; }
+    };
+
+    // Numbers groups of equal keys of 'nof_words' words in order of their first element; remap[i]
+    // is the group of element i. Returns the number of groups.
+    uint32_t group_equal_keys(const std::vector<uint64_t>& keys, size_t nof_words, std::vector<uint32_t>& remap)
+    {
+        const size_t nof_elements = keys.size() / nof_words;
+        const auto key_of = [&](size_t i) { return &keys[i * nof_words]; };
+
+        // open addressing over the first element of each group, at most half full
+        size_t table_size = 1;
+        while (table_size < 2 * nof_elements)
+            table_size *= 2;
+        constexpr uint32_t EMPTY = UINT32_MAX;
+        std::vector<uint32_t> table(table_size, EMPTY);
+        remap.resize(nof_elements);
+        uint32_t nof_groups = 0;
+        for (size_t i = 0; i < nof_elements; i++) {
+            size_t slot = hash_bytes(key_of(i), nof_words * sizeof(uint64_t)) & (table_size - 1);
+            while (table[slot] != EMPTY && !std::equal(key_of(i), key_of(i) + nof_words, key_of(table[slot])))
+                slot = (slot + 1) & (table_size - 1);
+            if (table[slot] == EMPTY) {
+                table[slot] = static_cast<uint32_t>(i);
+                remap[i] = nof_groups++;
+            } else {
+                remap[i] = remap[table[slot]];
+            }
+        }
+        return nof_groups;
+    }
+
+    // Groups vertices whose position, normal and texture coordinate each lie within 'epsilon' of
+    // the group's first vertex, numbered like group_equal_keys(). First vertices are bucketed by
+    // position in cells of 2 * epsilon. A vertex within epsilon of one is in the same cell or, on
+    // each axis, the neighbour on the side of the cell it is nearer to, so 8 cells cover it.
+    uint32_t group_near_vertices(const AssetManager::MeshData& mesh, float epsilon, std::vector<uint32_t>& remap)
+    {
+        const size_t nof_vertices = mesh.positions.size();
+        const bool has_normals = mesh.normals.size() == nof_vertices;
+        const bool has_tex_coords = mesh.texCoords.size() == nof_vertices;
+        const auto near = [&](uint32_t a, uint32_t b) {
+            return glm::length(mesh.positions[a] - mesh.positions[b]) <= epsilon &&
+                   (!has_normals || glm::length(mesh.normals[a] - mesh.normals[b]) <= epsilon) &&
+                   (!has_tex_coords || glm::length(mesh.texCoords[a] - mesh.texCoords[b]) <= epsilon);
+        };
+        // cells are looked up by hash, the vertices of a colliding cell are just more candidates
+        const auto cell_key = [](const int64_t cell[3]) { return hash_bytes(cell, 3 * sizeof(int64_t)); };
+        const double cell_size = 2.0 * static_cast<double>(epsilon);
+        constexpr double CELL_LIMIT = 0x1p62;
+
+        constexpr uint32_t NONE = UINT32_MAX;
+        std::unordered_map<uint64_t, uint32_t> first_in_cell{};
+        std::vector<uint32_t> next_in_cell(nof_vertices, NONE);
+        remap.resize(nof_vertices);
+        uint32_t nof_groups = 0;
+        for (uint32_t v = 0; v < nof_vertices; v++) {
+            const glm::vec3& p = mesh.positions[v];
+            if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) {
+                remap[v] = nof_groups++;
+                continue;
+            }
+            int64_t cell[3], side[3];
+            for (int c = 0; c < 3; c++) {
+                const double x = std::clamp(p[c] / cell_size, -CELL_LIMIT, CELL_LIMIT);
+                const double lower = std::floor(x);
+                cell[c] = static_cast<int64_t>(lower);
+                side[c] = x - lower < 0.5 ? -1 : 1;
+            }
+
+            // the earliest group within reach, so the result does not depend on the bucket order
+            uint32_t match = NONE;
+            for (int n = 0; n < 8; n++) {
+                int64_t neighbour[3];
+                for (int c = 0; c < 3; c++)
+                    neighbour[c] = cell[c] + ((n >> c) & 1 ? side[c] : 0);
+                const auto it = first_in_cell.find(cell_key(neighbour));
+                if (it == first_in_cell.end())
+                    continue;
+                for (uint32_t k = it->second; k != NONE; k = next_in_cell[k]) {
+                    if (k < match && near(v, k))
+                        match = k;
+                }
+            }
+            if (match != NONE) {
+                remap[v] = remap[match];
+                continue;
+            }
+
+            remap[v] = nof_groups++;
+            const auto [it, inserted] = first_in_cell.try_emplace(cell_key(cell), v);
+            if (!inserted) {
+                next_in_cell[v] = it->second;
+                it->second = v;
+            }
+        }
+        return nof_groups;
+    }
+
+    // Sum of squared distances to weighted planes, as the symmetric 4x4 matrix of Garland and
+    // Heckbert 1997 (upper triangle: xx xy xz xd yy yz yd zz zd dd).
+    struct Quadric {
+        double q[10]{};
+        // total weight, so that error() is a mean
+        double weight{0.0};
+
+        void add_plane(const glm::dvec3& n, double d, double w)
+        {
+            const double plane[4] = {n.x, n.y, n.z, d};
+            int k = 0;
+            for (int r = 0; r < 4; r++) {
+                for (int c = r; c < 4; c++)
+                    q[k++] += w * plane[r] * plane[c];
+            }
+        }
+        Quadric& operator+=(const Quadric& other)
+        {
+            for (int i = 0; i < 10; i++)
+                q[i] += other.q[i];
+            weight += other.weight;
+            return *this;
+        }
+        // root mean square distance of 'p' to the planes
+        [[nodiscard]] double error(const glm::vec3& p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const double sum = x * (q[0] * x + 2.0 * (q[1] * y + q[2] * z + q[3])) +
+                               y * (q[4] * y + 2.0 * (q[5] * z + q[6])) + z * (q[7] * z + 2.0 * q[8]) + q[9];
+            return weight > 0.0 ? std::sqrt(std::max(sum, 0.0) / weight) : 0.0;
+        }
+    };
+
+} // end anonymous namespace
+
+namespace mesh_optimizer {
+
+    uint64_t simulate_vertex_cache(std::span<const uint32_t> indices, size_t nof_vertices, uint32_t cache_size)
+    {
+        // a vertex is in the FIFO if it entered within the last 'cache_size' misses
+        std::vector<uint64_t> entered(nof_vertices, 0);
+        uint64_t misses = 0;
+        for (const uint32_t v : indices) {
+            if (entered[v] == 0 || misses - entered[v] >= cache_size) {
+                misses++;
+                entered[v] = misses;
+            }
+        }
+        return misses;
+    }
+
+    uint64_t count_referenced(std::span<const uint32_t> indices, size_t nof_vertices)
+    {
+        std::vector<uint8_t> seen(nof_vertices, 0);
+        uint64_t count = 0;
+        for (const uint32_t v : indices) {
+            count += seen[v] == 0;
+            seen[v] = 1;
+        }
+        return count;
+    }
+
+    void optimize_vertex_cache(std::span<uint32_t> indices, size_t nof_vertices, uint32_t cache_size)
+    {
+        const size_t nof_triangles = indices.size() / 3;
+        if (nof_triangles == 0 || nof_vertices == 0)
+            return;
+
+        // vertex -> triangles using it, as one array with per-vertex offsets
+        std::vector<uint32_t> live(nof_vertices, 0);
+        for (size_t i = 0; i < nof_triangles * 3; i++)
+            live[indices[i]]++;
+        std::vector<uint32_t> first(nof_vertices + 1, 0);
+        for (size_t v = 0; v < nof_vertices; v++)
+            first[v + 1] = first[v] + live[v];
+        std::vector<uint32_t> adjacency(first[nof_vertices]);
+        {
+            std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+            for (size_t t = 0; t < nof_triangles; t++) {
+                for (int k = 0; k < 3; k++)
+                    adjacency[cursor[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        const std::vector<uint32_t> source(indices.begin(), indices.begin() + nof_triangles * 3);
+        std::vector<uint8_t> emitted(nof_triangles, 0);
+        // time each vertex last entered the cache, it is still cached while time - entered < cache_size
+        std::vector<uint32_t> entered(nof_vertices, 0);
+        uint32_t time = cache_size + 1;
+        std::vector<uint32_t> dead_ends{};
+        std::vector<uint32_t> candidates{};
+        size_t scan = 0; // vertices below this have no live triangles left
+        size_t out = 0;
+
+        int64_t fan = 0;
+        while (fan >= 0) {
+            // emit every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (uint32_t a = first[fan]; a < first[fan + 1]; a++) {
+                const uint32_t t = adjacency[a];
+                if (emitted[t])
+                    continue;
+                emitted[t] = 1;
+                for (int k = 0; k < 3; k++) {
+                    const uint32_t v = source[t * 3 + k];
+                    indices[out++] = v;
+                    dead_ends.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - entered[v] > cache_size)
+                        entered[v] = time++;
+                }
+            }
+
+            // next fan: the candidate that stays cached longest while its triangles are emitted
+            fan = -1;
+            int64_t best = -1;
+            for (const uint32_t v : candidates) {
+                if (live[v] == 0)
+                    continue;
+                int64_t priority = 0;
+                if (time - entered[v] + 2 * live[v] <= cache_size)
+                    priority = time - entered[v];
+                if (priority > best) {
+                    best = priority;
+                    fan = v;
+                }
+            }
+            if (fan != -1)
+                continue;
+
+            // dead end: back up to a recently used vertex, then fall back to scanning in order
+            while (!dead_ends.empty() && fan == -1) {
+                const uint32_t v = dead_ends.back();
+                dead_ends.pop_back();
+                if (live[v] > 0)
+                    fan = v;
+            }
+            for (; fan == -1 && scan < nof_vertices; scan++) {
+                if (live[scan] > 0)
+                    fan = static_cast<int64_t>(scan);
+            }
+        }
+    }
+
+    void optimize_overdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions, float threshold,
+                           uint32_t cache_size)
+    {
+        const size_t nof_triangles = indices.size() / 3;
+        if (nof_triangles < 2)
+            return;
+
+        // hard boundaries: no vertex of the triangle is cached, the order jumped elsewhere
+        std::vector<uint32_t> hard{};
+        {
+            FifoCache cache(positions.size(), cache_size);
+            for (size_t t = 0; t < nof_triangles; t++) {
+                if (cache.access(&indices[t * 3]) == 3)
+                    hard.push_back(static_cast<uint32_t>(t));
+            }
+            hard.push_back(static_cast<uint32_t>(nof_triangles));
+        }
+
+        // soft boundaries: end a cluster as soon as its own ACMR, starting from a cold cache, is
+        // within 'threshold' of the hard cluster's. Reordering can only cost those cold starts.
+        std::vector<uint32_t> clusters{};
+        {
+            FifoCache cache(positions.size(), cache_size);
+            for (size_t h = 0; h + 1 < hard.size(); h++) {
+                const uint32_t begin = hard[h], end = hard[h + 1];
+                uint32_t misses = 0;
+                for (uint32_t t = begin; t < end; t++)
+                    misses += cache.access(&indices[t * 3]);
+                const float limit = threshold * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+                cache.flush();
+                uint32_t start = begin;
+                misses = 0;
+                clusters.push_back(begin);
+                for (uint32_t t = begin; t < end; t++) {
+                    misses += cache.access(&indices[t * 3]);
+                    if (t + 1 < end && static_cast<float>(misses) <= limit * static_cast<float>(t + 1 - start)) {
+                        clusters.push_back(t + 1);
+                        start = t + 1;
+                        misses = 0;
+                        cache.flush();
+                    }
+                }
+                cache.flush();
+            }
+            clusters.push_back(static_cast<uint32_t>(nof_triangles));
+        }
+        const size_t nof_clusters = clusters.size() - 1;
+        if (nof_clusters < 2)
+            return;
+
+        // area weighted centroid and normal of every cluster and of the whole mesh
+        struct Cluster {
+            glm::vec3 centroid{0.0f};
+            glm::vec3 normal{0.0f};
+            float area{0.0f};
+            float occlusion{0.0f};
+        };
+        std::vector<Cluster> data(nof_clusters);
+        glm::vec3 mesh_centroid{0.0f};
+        float mesh_area = 0.0f;
+        for (size_t c = 0; c < nof_clusters; c++) {
+            Cluster& cluster = data[c];
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+                const glm::vec3& a = positions[indices[t * 3 + 0]];
+                const glm::vec3& b = positions[indices[t * 3 + 1]];
+                const glm::vec3& d = positions[indices[t * 3 + 2]];
+                const glm::vec3 n = glm::cross(b - a, d - a);
+                const float area = glm::length(n);
+                cluster.centroid += (a + b + d) * (area / 3.0f);
+                cluster.normal += n;
+                cluster.area += area;
+            }
+            mesh_centroid += cluster.centroid;
+            mesh_area += cluster.area;
+        }
+        if (mesh_area > 0.0f)
+            mesh_centroid /= mesh_area;
+
+        // clusters far out along their normal are in front of the rest of the mesh from most
+        // directions they can be seen from
+        for (auto& cluster : data) {
+            const float normal_length = glm::length(cluster.normal);
+            if (cluster.area > 0.0f && normal_length > 0.0f)
+                cluster.occlusion = glm::dot(cluster.centroid / cluster.area - mesh_centroid, cluster.normal / normal_length);
+        }
+        std::vector<uint32_t> order(nof_clusters);
+        for (uint32_t c = 0; c < nof_clusters; c++)
+            order[c] = c;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t l, uint32_t r) { return data[l].occlusion > data[r].occlusion; });
+
+        const std::vector<uint32_t> source(indices.begin(), indices.begin() + nof_triangles * 3);
+        size_t out = 0;
+        for (const uint32_t c : order) {
+            const size_t begin = size_t{clusters[c]} * 3, end = size_t{clusters[c + 1]} * 3;
+            std::copy(source.begin() + begin, source.begin() + end, indices.begin() + out);
+            out += end - begin;
+        }
+    }
+
+    void weld_vertices(AssetManager::MeshData& mesh, WeldStats& stats, float epsilon)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t nof_vertices = mesh.positions.size();
+        if (nof_vertices == 0 ||
+            std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t v) { return v >= nof_vertices; }))
+            return;
+
+        const bool has_normals = mesh.normals.size() == nof_vertices;
+        const bool has_tex_coords = mesh.texCoords.size() == nof_vertices;
+        std::vector<uint32_t> remap{};
+        uint32_t nof_kept = 0;
+        if (epsilon > 0.0f) {
+            nof_kept = group_near_vertices(mesh, epsilon, remap);
+        } else {
+            // every vertex as the words it is compared by, the raw float bits
+            const size_t nof_words = 3 + (has_normals ? 3 : 0) + (has_tex_coords ? 2 : 0);
+            std::vector<uint64_t> keys(nof_vertices * nof_words);
+            for (size_t v = 0; v < nof_vertices; v++) {
+                uint64_t* key = &keys[v * nof_words];
+                for (int c = 0; c < 3; c++)
+                    *key++ = std::bit_cast<uint32_t>(mesh.positions[v][c]);
+                for (int c = 0; has_normals && c < 3; c++)
+                    *key++ = std::bit_cast<uint32_t>(mesh.normals[v][c]);
+                for (int c = 0; has_tex_coords && c < 2; c++)
+                    *key++ = std::bit_cast<uint32_t>(mesh.texCoords[v][c]);
+            }
+            nof_kept = group_equal_keys(keys, nof_words, remap);
+        }
+
+        if (nof_kept < nof_vertices) {
+            // kept vertices are numbered in order and only move down, so compact in place
+            uint32_t kept = 0;
+            for (size_t v = 0; v < nof_vertices; v++) {
+                if (remap[v] != kept)
+                    continue;
+                mesh.positions[kept] = mesh.positions[v];
+                if (has_normals)
+                    mesh.normals[kept] = mesh.normals[v];
+                if (has_tex_coords)
+                    mesh.texCoords[kept] = mesh.texCoords[v];
+                kept++;
+            }
+            mesh.positions.resize(nof_kept);
+            if (has_normals)
+                mesh.normals.resize(nof_kept);
+            if (has_tex_coords)
+                mesh.texCoords.resize(nof_kept);
+            for (auto& i : mesh.indices)
+                i = remap[i];
+        }
+
+        WeldStats s{};
+        s.vertices_before = nof_vertices;
+        s.vertices_after = nof_kept;
+        s.weld_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats += s;
+    }
+
+    void optimize_vertex_fetch(AssetManager::MeshData& mesh)
+    {
+        const size_t nof_vertices = mesh.positions.size();
+        constexpr uint32_t UNUSED = UINT32_MAX;
+        std::vector<uint32_t> remap(nof_vertices, UNUSED);
+        uint32_t next = 0;
+        for (auto& v : mesh.indices) {
+            if (remap[v] == UNUSED)
+                remap[v] = next++;
+            v = remap[v];
+        }
+        for (auto& r : remap) {
+            if (r == UNUSED)
+                r = next++;
+        }
+
+        const auto permute = [&](auto& attribute) {
+            if (attribute.size() != nof_vertices)
+                return;
+            std::remove_reference_t<decltype(attribute)> reordered(nof_vertices);
+            for (size_t v = 0; v < nof_vertices; v++)
+                reordered[remap[v]] = attribute[v];
+            attribute.swap(reordered);
+        };
+        permute(mesh.positions);
+        permute(mesh.normals);
+        permute(mesh.texCoords);
+    }
+
+    void generate_lods(AssetManager::MeshData& mesh, LodStats& stats, uint32_t nof_levels, float ratio)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t nof_vertices = mesh.positions.size();
+        nof_levels = std::min(nof_levels, AssetManager::MAX_LODS);
+        if (nof_levels == 0 || !mesh.lods.empty() || mesh.indices.size() % 3 != 0 ||
+            std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t v) { return v >= nof_vertices; }))
+            return;
+        ratio = std::clamp(ratio, LOD_MIN_RATIO, LOD_MAX_RATIO);
+
+        // vertices that differ only in normal or texture coordinate share a position
+        std::vector<uint32_t> pos_of{};
+        uint32_t nof_positions = 0;
+        {
+            std::vector<uint64_t> keys(nof_vertices * 3);
+            for (size_t v = 0; v < nof_vertices; v++) {
+                for (int c = 0; c < 3; c++)
+                    keys[v * 3 + c] = std::bit_cast<uint32_t>(mesh.positions[v][c]);
+            }
+            nof_positions = group_equal_keys(keys, 3, pos_of);
+        }
+        std::vector<glm::vec3> point(nof_positions);
+        for (size_t v = 0; v < nof_vertices; v++)
+            point[pos_of[v]] = mesh.positions[v];
+
+        // triangles with a repeated position cover nothing and are left out of every level
+        const size_t nof_triangles = mesh.indices.size() / 3;
+        std::vector<uint32_t> tri(mesh.indices);
+        std::vector<uint8_t> alive(nof_triangles, 0);
+        std::vector<std::vector<uint32_t>> tris_at(nof_positions);
+        const auto position = [&](size_t t, int c) { return pos_of[tri[t * 3 + c]]; };
+        size_t nof_alive = 0;
+        for (size_t t = 0; t < nof_triangles; t++) {
+            const uint32_t a = position(t, 0), b = position(t, 1), c = position(t, 2);
+            if (a == b || b == c || c == a)
+                continue;
+            alive[t] = 1;
+            nof_alive++;
+            for (const uint32_t p : {a, b, c})
+                tris_at[p].push_back(static_cast<uint32_t>(t));
+        }
+
+        // edges used by one triangle are borders, by more than two non-manifold
+        std::vector<uint8_t> border(nof_positions, 0), locked(nof_positions, 0);
+        std::vector<uint64_t> edges{};
+        for (size_t t = 0; t < nof_triangles; t++) {
+            for (int c = 0; alive[t] && c < 3; c++) {
+                const uint64_t a = position(t, c), b = position(t, (c + 1) % 3);
+                edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        std::vector<uint64_t> border_edges{};
+        for (size_t e = 0; e < edges.size();) {
+            size_t end = e + 1;
+            while (end < edges.size() && edges[end] == edges[e])
+                end++;
+            const uint32_t a = static_cast<uint32_t>(edges[e] >> 32), b = static_cast<uint32_t>(edges[e]);
+            if (end - e == 1) {
+                border[a] = border[b] = 1;
+                border_edges.push_back(edges[e]);
+            } else if (end - e > 2) {
+                locked[a] = locked[b] = 1;
+            }
+            e = end;
+        }
+
+        // area weighted planes of the triangles around each position, plus planes through border
+        // edges perpendicular to their triangle that keep borders in place
+        std::vector<Quadric> quadrics(nof_positions);
+        for (size_t t = 0; t < nof_triangles; t++) {
+            if (!alive[t])
+                continue;
+            const glm::dvec3 a = point[position(t, 0)], b = point[position(t, 1)], c = point[position(t, 2)];
+            const glm::dvec3 n = glm::cross(b - a, c - a);
+            const double length = glm::length(n);
+            if (length <= 0.0)
+                continue;
+            const glm::dvec3 normal = n / length;
+            const double area = 0.5 * length;
+            for (int k = 0; k < 3; k++) {
+                Quadric& q = quadrics[position(t, k)];
+                q.add_plane(normal, -glm::dot(normal, a), area);
+                q.weight += area;
+            }
+            for (int k = 0; k < 3; k++) {
+                const uint32_t pa = position(t, k), pb = position(t, (k + 1) % 3);
+                const uint64_t key = uint64_t{std::min(pa, pb)} << 32 | std::max(pa, pb);
+                if (!border[pa] || !border[pb] || !std::binary_search(border_edges.begin(), border_edges.end(), key))
+                    continue;
+                const glm::dvec3 e = glm::dvec3(point[pb]) - glm::dvec3(point[pa]);
+                const glm::dvec3 m = glm::cross(e, normal);
+                const double m_length = glm::length(m);
+                if (m_length <= 0.0)
+                    continue;
+                const double weight = LOD_BORDER_WEIGHT * glm::dot(e, e);
+                quadrics[pa].add_plane(m / m_length, -glm::dot(m / m_length, glm::dvec3(point[pa])), weight);
+                quadrics[pb].add_plane(m / m_length, -glm::dot(m / m_length, glm::dvec3(point[pa])), weight);
+            }
+        }
+
+        std::vector<uint32_t> neighbours_from{}, neighbours_to{}, opposite{};
+        const auto neighbours = [&](uint32_t p, std::vector<uint32_t>& out) {
+            out.clear();
+            for (const uint32_t t : tris_at[p]) {
+                for (int c = 0; alive[t] && c < 3; c++) {
+                    if (position(t, c) != p)
+                        out.push_back(position(t, c));
+                }
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        };
+        const auto corner_at = [&](uint32_t t, uint32_t p) {
+            int c = 0;
+            while (position(t, c) != p)
+                c++;
+            return c;
+        };
+
+        // The cheapest collapse of every movable position onto a neighbour, cheapest first. An
+        // entry is dropped once its position was queued again or its target changed.
+        struct Collapse {
+            double error;
+            uint32_t from, to;
+            uint32_t from_queued, to_version;
+            bool operator>(const Collapse& other) const { return error > other.error; }
+        };
+        std::vector<uint32_t> queued(nof_positions, 0), version(nof_positions, 0);
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> heap{};
+        std::vector<uint32_t> candidates{};
+        const auto push = [&](uint32_t from) {
+            if (locked[from])
+                return;
+            neighbours(from, candidates);
+            Collapse best{std::numeric_limits<double>::infinity(), from, from, ++queued[from], 0};
+            for (const uint32_t to : candidates) {
+                Quadric q = quadrics[from];
+                q += quadrics[to];
+                const double error = q.error(point[to]);
+                if (error < best.error) {
+                    best.error = error;
+                    best.to = to;
+                    best.to_version = version[to];
+                }
+            }
+            if (best.to != from)
+                heap.push(best);
+        };
+        for (uint32_t p = 0; p < nof_positions; p++)
+            push(p);
+
+        std::vector<std::pair<uint32_t, uint32_t>> vertex_map{};
+        std::vector<uint32_t> requeue{};
+
+        // Moves position 'from' onto 'to' if the surface stays manifold, no triangle flips and every
+        // vertex at 'from' has a vertex at 'to' to continue its attributes with.
+        const auto collapse = [&](uint32_t from, uint32_t to) {
+            vertex_map.clear();
+            opposite.clear();
+            for (const uint32_t t : tris_at[from]) {
+                if (!alive[t])
+                    continue;
+                const int c_from = corner_at(t, from);
+                const int c_other = (c_from + 1) % 3;
+                const int c_to = position(t, c_other) == to ? c_other : (c_from + 2) % 3;
+                if (position(t, c_to) != to)
+                    continue;
+                const uint32_t w_from = tri[t * 3 + c_from], w_to = tri[t * 3 + c_to];
+                for (const auto& [a, b] : vertex_map) {
+                    if (a == w_from && b != w_to)
+                        return false;
+                }
+                vertex_map.emplace_back(w_from, w_to);
+                opposite.push_back(position(t, 3 - c_from - c_to));
+            }
+            // one shared triangle: a border edge, two: an interior edge, others are not collapsible
+            if (opposite.empty() || opposite.size() > 2 || (opposite.size() == 1) != (border[from] && border[to]))
+                return false;
+            if (opposite.size() == 2 && border[from])
+                return false;
+
+            // link condition: the only common neighbours are the shared triangles' third corners
+            neighbours(from, neighbours_from);
+            neighbours(to, neighbours_to);
+            std::sort(opposite.begin(), opposite.end());
+            size_t nof_common = 0;
+            for (size_t i = 0, j = 0; i < neighbours_from.size() && j < neighbours_to.size();) {
+                if (neighbours_from[i] < neighbours_to[j]) {
+                    i++;
+                } else if (neighbours_from[i] > neighbours_to[j]) {
+                    j++;
+                } else {
+                    if (!std::binary_search(opposite.begin(), opposite.end(), neighbours_from[i]))
+                        return false;
+                    nof_common++;
+                    i++;
+                    j++;
+                }
+            }
+            if (nof_common != opposite.size())
+                return false;
+
+            for (const uint32_t t : tris_at[from]) {
+                if (!alive[t])
+                    continue;
+                const int c = corner_at(t, from);
+                const uint32_t a = position(t, (c + 1) % 3), b = position(t, (c + 2) % 3);
+                if (a == to || b == to)
+                    continue;
+                const auto mapped = std::find_if(vertex_map.begin(), vertex_map.end(),
+                                                 [&](const auto& m) { return m.first == tri[t * 3 + c]; });
+                if (mapped == vertex_map.end())
+                    return false;
+                const glm::vec3 before = glm::cross(point[a] - point[from], point[b] - point[from]);
+                const glm::vec3 after = glm::cross(point[a] - point[to], point[b] - point[to]);
+                if (glm::dot(before, after) <= 0.0f)
+                    return false;
+            }
+
+            for (const uint32_t t : tris_at[from]) {
+                if (!alive[t])
+                    continue;
+                const int c = corner_at(t, from);
+                if (position(t, (c + 1) % 3) == to || position(t, (c + 2) % 3) == to) {
+                    alive[t] = 0;
+                    nof_alive--;
+                    continue;
+                }
+                for (const auto& [a, b] : vertex_map) {
+                    if (a == tri[t * 3 + c])
+                        tri[t * 3 + c] = b;
+                }
+                tris_at[to].push_back(t);
+            }
+            tris_at[from].clear();
+            std::erase_if(tris_at[to], [&](uint32_t t) { return !alive[t]; });
+            quadrics[to] += quadrics[from];
+            version[from]++;
+            version[to]++;
+            locked[from] = 1; // gone, never moves again
+            return true;
+        };
+
+        // each level continues collapsing from the one before until it reaches its share of the
+        // triangles, or stops the chain if it could not remove at least a tenth of them
+        const size_t base_alive = nof_alive;
+        size_t previous = base_alive;
+        double max_error = 0.0;
+        for (uint32_t level = 0; level < nof_levels; level++) {
+            const size_t target = static_cast<size_t>(static_cast<double>(base_alive) * std::pow(ratio, level + 1.0));
+            while (nof_alive > target && !heap.empty()) {
+                const Collapse next = heap.top();
+                heap.pop();
+                if (next.from_queued != queued[next.from] || next.to_version != version[next.to])
+                    continue;
+                if (!collapse(next.from, next.to))
+                    continue;
+                // the target and everything around it now have different costs
+                max_error = std::max(max_error, next.error);
+                neighbours(next.to, requeue);
+                push(next.to);
+                for (const uint32_t p : requeue)
+                    push(p);
+            }
+            if (nof_alive == 0 || nof_alive * 10 > previous * 9)
+                break;
+
+            AssetManager::MeshLod lod{};
+            lod.first = static_cast<uint32_t>(mesh.indices.size());
+            lod.count = static_cast<uint32_t>(nof_alive * 3);
+            lod.error = static_cast<float>(max_error);
+            for (size_t t = 0; t < nof_triangles; t++) {
+                if (alive[t])
+                    mesh.indices.insert(mesh.indices.end(), &tri[t * 3], &tri[t * 3] + 3);
+            }
+            mesh.lods.push_back(lod);
+            previous = nof_alive;
+        }
+
+        LodStats s{};
+        s.meshes_with_lods = mesh.lods.empty() ? 0 : 1;
+        s.levels = mesh.lods.size();
+        s.triangles = nof_triangles;
+        s.coarsest_triangles = mesh.lods.empty() ? nof_triangles : mesh.lods.back().count / 3;
+        s.lod_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats += s;
+    }
+
+    void optimize(AssetManager::MeshData& mesh, VertexCacheStats& stats, bool opaque)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const size_t nof_vertices = mesh.positions.size();
+        if (mesh.indices.size() % 3 != 0 ||
+            std::any_of(mesh.indices.begin(), mesh.indices.end(), [&](uint32_t v) { return v >= nof_vertices; }))
+            return;
+
+        // the full detail range and each level of detail are drawn on their own
+        std::vector<std::span<uint32_t>> ranges{std::span(mesh.indices).first(mesh.base_count())};
+        for (const auto& lod : mesh.lods) {
+            if (lod.count % 3 != 0 || uint64_t{lod.first} + lod.count > mesh.indices.size())
+                return;
+            ranges.push_back(std::span(mesh.indices).subspan(lod.first, lod.count));
+        }
+
+        VertexCacheStats s{};
+        s.triangles = ranges[0].size() / 3;
+        s.vertices = count_referenced(ranges[0], nof_vertices);
+        s.transformed_before = simulate_vertex_cache(ranges[0], nof_vertices);
+        for (const auto range : ranges) {
+            optimize_vertex_cache(range, nof_vertices);
+            if (opaque)
+                optimize_overdraw(range, mesh.positions);
+        }
+        optimize_vertex_fetch(mesh);
+        s.transformed_after = simulate_vertex_cache(ranges[0], nof_vertices);
+        s.optimize_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats += s;
+    }
+
+}; // end namespace 'mesh_optimizer'
@@ -0,0 +1,505 @@
+#include "model_cache.hpp"
+#include "hash.hpp"
+#include "job_system.hpp"
+#include "mapped_file.hpp"
+
+#include "glad.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+
+namespace AssetManager {
+
+    /*
+     * On-disk layout (native endianness, every block 16-byte aligned):
+     *   CacheHeader | MeshRecord[] | NodeRecord[] | InstanceRecord[] | offset matrices | MaterialRecord[] |
+     *   TextureRecord[] | payload
+     * Nodes are in TransformHierarchy order. Instance model matrices are not stored, they are
+     * recomputed from the nodes after loading.
+     * Payload offsets are absolute file offsets.
+     */
+
+    static constexpr char CACHE_MAGIC[8] = {'G', 'L', 'T', 'F', 'C', 'C', 'H', '\0'};
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t nof_meshes;
+        uint64_t key;
+        uint32_t nof_materials;
+        uint32_t nof_textures;
+        uint32_t nof_nodes;
+        uint32_t nof_instances;
+        uint32_t nof_instance_offsets;
+        uint32_t pad[3];
+    };
+
+    struct MeshRecord {
+        int32_t mat_idx; // relative to the model's first material, -1 for none
+        float bounds_min[3];
+        float bounds_max[3];
+        uint64_t nof_vertices;
+        uint64_t nof_indices;
+        uint64_t positions;
+        uint64_t normals; // 0 if the mesh has none
+        uint64_t tex_coords; // 0 if the mesh has none
+        uint64_t indices;
+        uint32_t nof_lods;
+        uint32_t pad;
+        MeshLod lods[MAX_LODS]; // ranges of the indices above
+    };
+
+    struct NodeRecord {
+        int32_t parent; // always below the node's own index, -1 for roots
+        float translation[3];
+        float rotation[4];
+        float scale[3];
+        float local[16];
+        uint32_t pad;
+    };
+
+    struct InstanceRecord {
+        uint32_t mesh;
+        uint32_t node;
+        uint32_t offset; // Model::Instance::NO_OFFSET for none
+        uint32_t pad;
+    };
+
+    struct MaterialRecord {
+        uint32_t double_sided;
+        uint32_t mode;
+        float alpha_cutoff;
+        float base_color[4];
+        float metalness;
+        float roughness;
+        int32_t texture_idx[4]; // into the TextureRecords, -1 for none
+    };
+
+    struct TextureRecord {
+        Texture::TextureConfig conf;
+        uint32_t compressed;
+        uint32_t decode_on_load;
+        uint64_t content_key; // reused if a texture with this key is already loaded
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static_assert(std::is_trivially_copyable_v<CacheHeader>);
+    static_assert(std::is_trivially_copyable_v<MeshRecord>);
+    static_assert(std::is_trivially_copyable_v<NodeRecord>);
+    static_assert(std::is_trivially_copyable_v<InstanceRecord>);
+    static_assert(std::is_trivially_copyable_v<MaterialRecord>);
+    static_assert(std::is_trivially_copyable_v<TextureRecord>);
+
+    static constexpr uint64_t align16(uint64_t v) { return (v + 15) & ~uint64_t{15}; }
+
+    std::filesystem::path cache_path(const std::filesystem::path& source)
+    {
+        auto path = source;
+        path += ".gltfcache";
+        return path;
+    }
+
+    bool compute_cache_key(const std::filesystem::path& source, const LoadOptions& options, uint64_t& key)
+    {
+        MappedFile file{};
+        if (!file.open(source))
+            return false;
+
+        // hash fixed size chunks in parallel, then hash the chunk hashes in order
+        constexpr size_t CHUNK_SIZE = 16 << 20;
+        const size_t nof_chunks = (file.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        std::vector<uint64_t> chunk_hashes(nof_chunks);
+        job_system().parallel_for(nof_chunks, [&](size_t c) {
+            const size_t begin = c * CHUNK_SIZE;
+            const size_t size = std::min(CHUNK_SIZE, file.size() - begin);
+            chunk_hashes[c] = hash_bytes(file.data() + begin, size, c);
+        });
+
+        key = hash_bytes(chunk_hashes.data(), chunk_hashes.size() * sizeof(uint64_t), (uint64_t{CACHE_VERSION} << 32) ^ file.size());
+
+        // only options that change what ends up in the cache belong here
+        const uint64_t layout_options = (options.lazy_textures ? 1 : 0) | (options.optimize_meshes ? 2 : 0) |
+                                        (options.weld_vertices ? 4 : 0) |
+                                        (uint64_t{std::min(options.lod_levels, MAX_LODS)} << 8) |
+                                        (uint64_t{static_cast<uint32_t>(options.scene)} << 32);
+        key = hash_bytes(&layout_options, sizeof(layout_options), key);
+        if (options.weld_vertices)
+            key = hash_bytes(&options.weld_epsilon, sizeof(options.weld_epsilon), key);
+        if (options.lod_levels > 0)
+            key = hash_bytes(&options.lod_ratio, sizeof(options.lod_ratio), key);
+        return true;
+    }
+
+    bool load_cached_model(Model& model, const std::filesystem::path& cache, uint64_t key)
+    {
+        if (!std::filesystem::exists(cache))
+            return false;
+
+        MappedFile file{};
+        if (!file.open(cache) || file.size() < sizeof(CacheHeader))
+            return false;
+
+        CacheHeader header{};
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) {
+            printf("Ignoring model cache '%s' with unknown format.\n", cache.c_str());
+            return false;
+        }
+        if (header.key != key) {
+            printf("Model cache '%s' is stale, rebuilding.\n", cache.c_str());
+            return false;
+        }
+
+        const uint64_t mesh_offset = align16(sizeof(CacheHeader));
+        const uint64_t node_offset = align16(mesh_offset + uint64_t{header.nof_meshes} * sizeof(MeshRecord));
+        const uint64_t instance_offset = align16(node_offset + uint64_t{header.nof_nodes} * sizeof(NodeRecord));
+        const uint64_t matrix_offset = align16(instance_offset + uint64_t{header.nof_instances} * sizeof(InstanceRecord));
+        const uint64_t material_offset = align16(matrix_offset + uint64_t{header.nof_instance_offsets} * sizeof(glm::mat4));
+        const uint64_t texture_offset = align16(material_offset + uint64_t{header.nof_materials} * sizeof(MaterialRecord));
+        const uint64_t records_end = texture_offset + uint64_t{header.nof_textures} * sizeof(TextureRecord);
+        if (records_end > file.size())
+            return false;
+
+        std::vector<MeshRecord> mesh_records(header.nof_meshes);
+        std::vector<NodeRecord> node_records(header.nof_nodes);
+        std::vector<InstanceRecord> instance_records(header.nof_instances);
+        std::vector<glm::mat4> instance_offsets(header.nof_instance_offsets);
+        std::vector<MaterialRecord> material_records(header.nof_materials);
+        std::vector<TextureRecord> texture_records(header.nof_textures);
+        std::memcpy(mesh_records.data(), file.data() + mesh_offset, mesh_records.size() * sizeof(MeshRecord));
+        std::memcpy(node_records.data(), file.data() + node_offset, node_records.size() * sizeof(NodeRecord));
+        std::memcpy(instance_records.data(), file.data() + instance_offset, instance_records.size() * sizeof(InstanceRecord));
+        std::memcpy(instance_offsets.data(), file.data() + matrix_offset, instance_offsets.size() * sizeof(glm::mat4));
+        std::memcpy(material_records.data(), file.data() + material_offset, material_records.size() * sizeof(MaterialRecord));
+        std::memcpy(texture_records.data(), file.data() + texture_offset, texture_records.size() * sizeof(TextureRecord));
+
+        // validate everything before touching any global state
+        const auto in_file = [&](uint64_t offset, uint64_t size) {
+            return offset <= file.size() && size <= file.size() - offset;
+        };
+        uint64_t nof_vertices = 0, nof_indices = 0;
+        for (const auto& r : mesh_records) {
+            nof_vertices += r.nof_vertices;
+            nof_indices += r.nof_indices;
+            if (!in_file(r.positions, r.nof_vertices * sizeof(glm::vec3)) ||
+                (r.normals && !in_file(r.normals, r.nof_vertices * sizeof(glm::vec3))) ||
+                (r.tex_coords && !in_file(r.tex_coords, r.nof_vertices * sizeof(glm::vec2))) ||
+                !in_file(r.indices, r.nof_indices * sizeof(uint32_t)) ||
+                r.mat_idx >= static_cast<int32_t>(header.nof_materials) ||
+                nof_vertices > INT32_MAX || nof_indices > UINT32_MAX || r.nof_lods > MAX_LODS) {
+                printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                return false;
+            }
+            for (uint32_t l = 0; l < r.nof_lods; l++) {
+                if (uint64_t{r.lods[l].first} + r.lods[l].count > r.nof_indices) {
+                    printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                    return false;
+                }
+            }
+        }
+        for (size_t i = 0; i < node_records.size(); i++) {
+            if (node_records[i].parent < -1 || node_records[i].parent >= static_cast<int64_t>(i)) {
+                printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                return false;
+            }
+        }
+        for (const auto& r : instance_records) {
+            if (r.mesh >= header.nof_meshes || r.node >= header.nof_nodes ||
+                (r.offset != Model::Instance::NO_OFFSET && r.offset >= header.nof_instance_offsets)) {
+                printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                return false;
+            }
+        }
+        for (const auto& r : texture_records) {
+            if (!in_file(r.offset, r.size)) {
+                printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                return false;
+            }
+        }
+        for (const auto& r : material_records) {
+            for (int32_t idx : r.texture_idx) {
+                if (idx >= static_cast<int32_t>(header.nof_textures)) {
+                    printf("Model cache '%s' is corrupt.\n", cache.c_str());
+                    return false;
+                }
+            }
+        }
+
+        const size_t material_base = materials.size();
+
+        // geometry first, so a failed upload returns before any material or texture was added
+        model.meshes.clear();
+        model.meshes.resize(mesh_records.size());
+        uint64_t index_bytes = 0;
+        for (size_t i = 0; i < mesh_records.size(); i++)
+            place_indices(model.meshes[i], mesh_records[i].nof_vertices, mesh_records[i].nof_indices, index_bytes);
+        bool uploaded = create_geometry(model.geometry, nof_vertices, index_bytes);
+        uint32_t first_vertex = 0;
+        for (size_t i = 0; uploaded && i < mesh_records.size(); i++) {
+            const auto& r = mesh_records[i];
+            const auto at = [&](uint64_t offset) { return file.data() + offset; };
+
+            MeshSpans spans{};
+            spans.positions = {reinterpret_cast<const glm::vec3*>(at(r.positions)), r.nof_vertices};
+            if (r.normals)
+                spans.normals = {reinterpret_cast<const glm::vec3*>(at(r.normals)), r.nof_vertices};
+            if (r.tex_coords)
+                spans.texCoords = {reinterpret_cast<const glm::vec2*>(at(r.tex_coords)), r.nof_vertices};
+            spans.indices = {reinterpret_cast<const uint32_t*>(at(r.indices)), r.nof_indices};
+            spans.lods = {r.lods, r.nof_lods};
+            spans.bounds_min = glm::vec3(r.bounds_min[0], r.bounds_min[1], r.bounds_min[2]);
+            spans.bounds_max = glm::vec3(r.bounds_max[0], r.bounds_max[1], r.bounds_max[2]);
+
+            auto& prim = model.meshes[i];
+            prim.base_vertex = static_cast<int32_t>(first_vertex);
+            uploaded = upload_mesh(model.geometry, prim, spans);
+            first_vertex += r.nof_vertices;
+            prim.mat_idx = r.mat_idx < 0 ? -1 : static_cast<int32_t>(material_base + r.mat_idx);
+        }
+        // leave the model as it was, load_glb() falls back to the source file
+        if (!uploaded) {
+            printf("Failed to upload the geometry of model cache '%s'.\n", cache.c_str());
+            if (model.geometry.VAO != 0)
+                destroy_geometry(model.geometry);
+            model.meshes.clear();
+            return false;
+        }
+
+        std::vector<int32_t> record_textures(texture_records.size(), -1);
+        for (size_t i = 0; i < texture_records.size(); i++) {
+            const auto& r = texture_records[i];
+            record_textures[i] = find_cached_texture(r.content_key);
+            if (record_textures[i] != -1)
+                continue;
+
+            const auto payload = file.bytes().subspan(r.offset, r.size);
+            Texture t{};
+            bool ok = true;
+            if (r.compressed && !r.decode_on_load)
+                t.create_lazy(r.conf, payload);
+            else if (r.compressed)
+                ok = t.create_decoded(r.conf, payload);
+            else
+                ok = t.create_texture(r.conf, payload.data());
+            if (!ok)
+                printf("Failed to upload cached texture, skipping.\n");
+
+            textures.push_back(t);
+            record_textures[i] = static_cast<int32_t>(textures.size() - 1);
+            if (ok)
+                cache_texture(r.content_key, record_textures[i]);
+        }
+
+        const auto rebase_texture = [&](int32_t idx) {
+            return idx < 0 ? -1 : record_textures[idx];
+        };
+        for (const auto& r : material_records) {
+            Material m{};
+            m.double_sided = r.double_sided != 0;
+            m.mode = static_cast<Material::AlphaMode>(r.mode);
+            m.alpha_cutoff = r.alpha_cutoff;
+            m.base_color = glm::vec4(r.base_color[0], r.base_color[1], r.base_color[2], r.base_color[3]);
+            m.metalness = r.metalness;
+            m.roughness = r.roughness;
+            m.base_color_texture_idx = rebase_texture(r.texture_idx[0]);
+            m.metallic_roughness_texture_idx = rebase_texture(r.texture_idx[1]);
+            m.normal_texture_idx = rebase_texture(r.texture_idx[2]);
+            m.emissive_texture_idx = rebase_texture(r.texture_idx[3]);
+            materials.push_back(m);
+        }
+
+        model.nodes = TransformHierarchy{};
+        for (const auto& r : node_records) {
+            glm::mat4 local;
+            std::memcpy(&local[0][0], r.local, sizeof(r.local));
+            const uint32_t n = model.nodes.add(r.parent, local);
+            model.nodes.translation[n] = glm::vec3(r.translation[0], r.translation[1], r.translation[2]);
+            model.nodes.rotation[n] = glm::vec4(r.rotation[0], r.rotation[1], r.rotation[2], r.rotation[3]);
+            model.nodes.scale[n] = glm::vec3(r.scale[0], r.scale[1], r.scale[2]);
+        }
+        model.nodes.finalize();
+
+        model.instance_offsets = std::move(instance_offsets);
+        model.instances.resize(instance_records.size());
+        for (size_t i = 0; i < instance_records.size(); i++) {
+            model.instances[i].primitive = instance_records[i].mesh;
+            model.instances[i].node = instance_records[i].node;
+            model.instances[i].offset = instance_records[i].offset;
+        }
+        group_instances(model);
+
+        printf("Loaded '%s' from model cache.\n", model.name.c_str());
+        return true;
+    }
+
+    bool write_cached_model(
+        const Model& model,
+        const std::filesystem::path& cache,
+        uint64_t key,
+        const BakedModel& bake,
+        size_t material_base
+    ) {
+        if (model.meshes.size() != bake.meshes.size()) {
+            printf("Model cache: baked data does not match the loaded model.\n");
+            return false;
+        }
+
+        const size_t nof_materials = materials.size() - material_base;
+        const uint64_t mesh_offset = align16(sizeof(CacheHeader));
+        const uint64_t node_offset = align16(mesh_offset + model.meshes.size() * sizeof(MeshRecord));
+        const uint64_t instance_offset = align16(node_offset + model.nodes.size() * sizeof(NodeRecord));
+        const uint64_t matrix_offset = align16(instance_offset + model.instances.size() * sizeof(InstanceRecord));
+        const uint64_t material_offset = align16(matrix_offset + model.instance_offsets.size() * sizeof(glm::mat4));
+        const uint64_t texture_offset = align16(material_offset + nof_materials * sizeof(MaterialRecord));
+        uint64_t cursor = align16(texture_offset + bake.textures.size() * sizeof(TextureRecord));
+
+        // assign payload offsets in the order the payload is written below
+        const auto reserve = [&](uint64_t size) {
+            const uint64_t offset = cursor;
+            cursor = align16(cursor + size);
+            return offset;
+        };
+
+        std::vector<MeshRecord> mesh_records(model.meshes.size());
+        for (size_t i = 0; i < model.meshes.size(); i++) {
+            const auto& prim = model.meshes[i];
+            const auto& data = bake.meshes[i];
+            auto& r = mesh_records[i];
+            r = MeshRecord{};
+            r.mat_idx = prim.mat_idx < 0 ? -1 : static_cast<int32_t>(prim.mat_idx - material_base);
+            for (int k = 0; k < 3; k++) {
+                r.bounds_min[k] = data.bounds_min[k];
+                r.bounds_max[k] = data.bounds_max[k];
+            }
+            r.nof_vertices = data.positions.size();
+            r.nof_indices = data.indices.size();
+            r.positions = reserve(data.positions.size() * sizeof(glm::vec3));
+            r.normals = data.normals.empty() ? 0 : reserve(data.normals.size() * sizeof(glm::vec3));
+            r.tex_coords = data.texCoords.empty() ? 0 : reserve(data.texCoords.size() * sizeof(glm::vec2));
+            r.indices = reserve(data.indices.size() * sizeof(uint32_t));
+            r.nof_lods = static_cast<uint32_t>(std::min<size_t>(data.lods.size(), MAX_LODS));
+            std::copy_n(data.lods.begin(), r.nof_lods, r.lods);
+        }
+
+        const auto& nodes = model.nodes;
+        std::vector<NodeRecord> node_records(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto& r = node_records[i];
+            r = NodeRecord{};
+            r.parent = nodes.parent[i];
+            for (int k = 0; k < 3; k++) {
+                r.translation[k] = nodes.translation[i][k];
+                r.scale[k] = nodes.scale[i][k];
+            }
+            for (int k = 0; k < 4; k++)
+                r.rotation[k] = nodes.rotation[i][k];
+            std::memcpy(r.local, &nodes.local[i][0][0], sizeof(r.local));
+        }
+
+        std::vector<InstanceRecord> instance_records(model.instances.size());
+        for (size_t i = 0; i < model.instances.size(); i++) {
+            auto& r = instance_records[i];
+            r = InstanceRecord{};
+            r.mesh = model.instances[i].primitive;
+            r.node = model.instances[i].node;
+            r.offset = model.instances[i].offset;
+        }
+
+        std::unordered_map<int32_t, int32_t> texture_records_of{};
+        for (size_t i = 0; i < bake.textures.size(); i++)
+            texture_records_of.emplace(bake.textures[i].texture_idx, static_cast<int32_t>(i));
+        const auto relative_texture = [&](int32_t idx) {
+            const auto it = texture_records_of.find(idx);
+            return it != texture_records_of.end() ? it->second : -1;
+        };
+        std::vector<MaterialRecord> material_records(nof_materials);
+        for (size_t i = 0; i < nof_materials; i++) {
+            const auto& m = materials[material_base + i];
+            auto& r = material_records[i];
+            r = MaterialRecord{};
+            r.double_sided = m.double_sided;
+            r.mode = static_cast<uint32_t>(m.mode);
+            r.alpha_cutoff = m.alpha_cutoff;
+            for (int k = 0; k < 4; k++)
+                r.base_color[k] = m.base_color[k];
+            r.metalness = m.metalness;
+            r.roughness = m.roughness;
+            r.texture_idx[0] = relative_texture(m.base_color_texture_idx);
+            r.texture_idx[1] = relative_texture(m.metallic_roughness_texture_idx);
+            r.texture_idx[2] = relative_texture(m.normal_texture_idx);
+            r.texture_idx[3] = relative_texture(m.emissive_texture_idx);
+        }
+
+        std::vector<TextureRecord> texture_records(bake.textures.size());
+        for (size_t i = 0; i < bake.textures.size(); i++) {
+            const auto& t = bake.textures[i];
+            auto& r = texture_records[i];
+            r = TextureRecord{};
+            r.conf = t.conf;
+            r.compressed = t.compressed;
+            r.decode_on_load = t.decode_on_load;
+            r.content_key = t.content_key;
+            r.size = t.payload.size();
+            r.offset = reserve(r.size);
+        }
+
+        CacheHeader header{};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.key = key;
+        header.nof_meshes = static_cast<uint32_t>(mesh_records.size());
+        header.nof_nodes = static_cast<uint32_t>(node_records.size());
+        header.nof_instances = static_cast<uint32_t>(instance_records.size());
+        header.nof_instance_offsets = static_cast<uint32_t>(model.instance_offsets.size());
+        header.nof_materials = static_cast<uint32_t>(material_records.size());
+        header.nof_textures = static_cast<uint32_t>(texture_records.size());
+
+        // write to a temporary and rename so a crash never leaves a half written cache
+        auto tmp = cache;
+        tmp += ".tmp";
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        const auto write_at = [&](uint64_t offset, const void* data, size_t size) {
+            static const char zeros[16] = {};
+            while (static_cast<uint64_t>(out.tellp()) < offset)
+                out.write(zeros, std::min<uint64_t>(sizeof(zeros), offset - out.tellp()));
+            out.write(static_cast<const char*>(data), size);
+        };
+
+        write_at(0, &header, sizeof(header));
+        write_at(mesh_offset, mesh_records.data(), mesh_records.size() * sizeof(MeshRecord));
+        write_at(node_offset, node_records.data(), node_records.size() * sizeof(NodeRecord));
+        write_at(instance_offset, instance_records.data(), instance_records.size() * sizeof(InstanceRecord));
+        write_at(matrix_offset, model.instance_offsets.data(), model.instance_offsets.size() * sizeof(glm::mat4));
+        write_at(material_offset, material_records.data(), material_records.size() * sizeof(MaterialRecord));
+        write_at(texture_offset, texture_records.data(), texture_records.size() * sizeof(TextureRecord));
+        for (size_t i = 0; i < bake.meshes.size(); i++) {
+            const auto& data = bake.meshes[i];
+            const auto& r = mesh_records[i];
+            write_at(r.positions, data.positions.data(), data.positions.size() * sizeof(glm::vec3));
+            if (r.normals)
+                write_at(r.normals, data.normals.data(), data.normals.size() * sizeof(glm::vec3));
+            if (r.tex_coords)
+                write_at(r.tex_coords, data.texCoords.data(), data.texCoords.size() * sizeof(glm::vec2));
+            write_at(r.indices, data.indices.data(), data.indices.size() * sizeof(uint32_t));
+        }
+        for (size_t i = 0; i < bake.textures.size(); i++)
+            write_at(texture_records[i].offset, bake.textures[i].payload.data(), bake.textures[i].payload.size());
+        write_at(cursor, nullptr, 0);
+
+        out.close();
+        if (!out)
+            return false;
+
+        std::error_code ec;
+        std::filesystem::rename(tmp, cache, ec);
+        return !ec;
+    }
+
+}; // end namespace 'AssetManager'
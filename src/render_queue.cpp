@@ -0,0 +1,292 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+namespace {
+
+    constexpr uint64_t PASS_BITS = 2, ALPHA_BITS = 2, CULL_BITS = 1, PIPELINE_BITS = 3;
+    constexpr uint64_t TEXTURE_SET_BITS = 12, MATERIAL_BITS = 12, VAO_BITS = 8, DEPTH_BITS = 24;
+    static_assert(PASS_BITS + ALPHA_BITS + CULL_BITS + PIPELINE_BITS + TEXTURE_SET_BITS + MATERIAL_BITS + VAO_BITS + DEPTH_BITS == 64);
+    static_assert((1u << PIPELINE_BITS) == RenderQueue::MAX_PIPELINES);
+
+    constexpr uint64_t mask(uint64_t bits) { return (1ull << bits) - 1; }
+
+    // Appends 'value' below the bits written so far.
+    struct KeyWriter {
+        uint64_t key{0};
+        void put(uint64_t value, uint64_t bits) { key = (key << bits) | (value & mask(bits)); }
+    };
+
+} // end anonymous namespace
+
+uint8_t RenderQueue::add_pipeline(const Shader& shader)
+{
+    if (pipelines.size() == MAX_PIPELINES) {
+        printf("RenderQueue: more than %zu pipelines.\n", MAX_PIPELINES);
+        return 0;
+    }
+    pipelines.push_back(Pipeline{
+        .shader = &shader,
+        .u_material = shader.uniform<uint32_t>("u_Material"),
+        .u_base_color_texture = shader.uniform<int>("baseColorTexture"),
+        .u_metallic_roughness_texture = shader.uniform<int>("metallicRoughnessTexture"),
+    });
+    return static_cast<uint8_t>(pipelines.size() - 1);
+}
+
+void RenderQueue::begin(const glm::mat4& view, float far_plane)
+{
+    this->view = view;
+    this->far_plane = far_plane;
+    packets.clear();
+    instance_data.clear();
+    texture_sets.clear();
+    vao_ids.clear();
+    frame_stats = Stats{};
+}
+
+uint32_t RenderQueue::texture_set(int32_t base_color_texture_idx, int32_t metallic_roughness_texture_idx)
+{
+    const uint64_t pair = (static_cast<uint64_t>(static_cast<uint32_t>(base_color_texture_idx)) << 32)
+                        | static_cast<uint32_t>(metallic_roughness_texture_idx);
+    return texture_sets.try_emplace(pair, static_cast<uint32_t>(texture_sets.size())).first->second;
+}
+
+uint32_t RenderQueue::vao_id(GLuint VAO)
+{
+    return vao_ids.try_emplace(VAO, static_cast<uint32_t>(vao_ids.size())).first->second;
+}
+
+void RenderQueue::push(const AssetManager::Model& model, uint8_t pipeline, const MaterialBuffer& materials,
+                       const Frustum* frustum, const LodSelector* lod)
+{
+    if (frustum) {
+        visible.resize(model.instances.size());
+        cull(*frustum, model.bounds, visible.data());
+    }
+
+    // view space distance of the instance's bounds center, quantized over [0, far_plane]
+    const auto depth_of = [&](uint32_t instance) {
+        const glm::vec4 center(model.bounds.center_x[instance], model.bounds.center_y[instance],
+                               model.bounds.center_z[instance], 1.0f);
+        const float distance = -(view * center).z;
+        const float normalized = std::clamp(distance / far_plane, 0.0f, 1.0f);
+        return static_cast<uint64_t>(normalized * static_cast<float>(mask(DEPTH_BITS)));
+    };
+
+    const Material fallback{};
+    for (const auto& p : model.meshes) {
+        if (p.count == 0)
+            continue;
+        const Material& m = p.mat_idx >= 0 ? AssetManager::materials[p.mat_idx] : fallback;
+        const Pass pass = m.mode == Material::AlphaMode::BLEND ? Pass::TRANSPARENT : Pass::OPAQUE;
+
+        Packet packet{
+            .VAO = model.geometry.VAO,
+            .offset = p.offset,
+            .count = p.count,
+            .base_vertex = p.base_vertex,
+            .index_type = p.index_type,
+            .material = materials.index_of(p.mat_idx),
+            .base_color_texture_idx = m.base_color_texture_idx,
+            .metallic_roughness_texture_idx = m.metallic_roughness_texture_idx,
+            .base_color = m.base_color,
+            .pipeline = pipeline,
+            .pass = pass,
+            .double_sided = m.double_sided,
+        };
+
+        const auto queue = [&](uint64_t depth) {
+            KeyWriter k{};
+            k.put(static_cast<uint64_t>(packet.pass), PASS_BITS);
+            if (packet.pass == Pass::TRANSPARENT)
+                k.put(mask(DEPTH_BITS) - depth, DEPTH_BITS);
+            k.put(static_cast<uint64_t>(m.mode), ALPHA_BITS);
+            k.put(packet.double_sided ? 1 : 0, CULL_BITS);
+            k.put(pipeline, PIPELINE_BITS);
+            k.put(texture_set(packet.base_color_texture_idx, packet.metallic_roughness_texture_idx), TEXTURE_SET_BITS);
+            k.put(packet.material, MATERIAL_BITS);
+            k.put(vao_id(packet.VAO), VAO_BITS);
+            if (packet.pass == Pass::OPAQUE)
+                k.put(depth, DEPTH_BITS);
+            packet.key = k.key;
+            packets.push_back(packet);
+            frame_stats.triangles += uint64_t{packet.count / 3} * packet.instance_count;
+        };
+        const auto use_level = [&](uint32_t level) {
+            const auto range = p.lod(level);
+            packet.offset = range.offset;
+            packet.count = range.count;
+        };
+
+        // opaque: one packet per level of detail for all visible instances at it, sorted by the nearest one
+        std::array<uint64_t, AssetManager::MAX_LODS + 1> nearest{};
+        nearest.fill(mask(DEPTH_BITS));
+        std::array<uint32_t, AssetManager::MAX_LODS + 1> level_counts{};
+        opaque_levels.clear();
+        for (uint32_t i = p.first_instance; i < p.first_instance + p.instance_count; i++) {
+            if (frustum && !visible[i]) {
+                frame_stats.culled++;
+                continue;
+            }
+            const uint64_t depth = depth_of(i);
+            const uint32_t level = lod ? lod->select(model, p, i) : 0;
+            if (pass == Pass::TRANSPARENT) {
+                instance_data.push_back(model.instances[i].model_matrix);
+                packet.first_instance = static_cast<uint32_t>(instance_data.size() - 1);
+                packet.instance_count = 1;
+                use_level(level);
+                queue(depth);
+            } else {
+                opaque_levels.push_back({i, level});
+                nearest[level] = std::min(nearest[level], depth);
+                level_counts[level]++;
+            }
+        }
+        for (uint32_t level = 0; level <= p.nof_lods; level++) {
+            if (level_counts[level] == 0)
+                continue;
+            packet.first_instance = static_cast<uint32_t>(instance_data.size());
+            for (const auto& [instance, instance_level] : opaque_levels) {
+                if (instance_level == level)
+                    instance_data.push_back(model.instances[instance].model_matrix);
+            }
+            packet.instance_count = level_counts[level];
+            use_level(level);
+            queue(nearest[level]);
+        }
+    }
+}
+
+void RenderQueue::sort()
+{
+    frame_stats.packets = static_cast<uint32_t>(packets.size());
+    frame_stats.instances = static_cast<uint32_t>(instance_data.size());
+    State state{};
+    for (const auto& p : packets)
+        apply(state, p, frame_stats.unsorted, false);
+
+    items.resize(packets.size());
+    scratch.resize(packets.size());
+    for (uint32_t i = 0; i < packets.size(); i++)
+        items[i] = SortItem{packets[i].key, i};
+
+    // LSD radix sort, one byte per pass. Stable, so equal keys keep their push order.
+    // Bytes all keys share (most of the upper ones for a typical scene) are skipped.
+    std::array<std::array<uint32_t, 256>, 8> counts{};
+    for (const auto& item : items) {
+        for (size_t b = 0; b < 8; b++)
+            counts[b][(item.key >> (b * 8)) & 0xFF]++;
+    }
+    for (size_t b = 0; b < 8; b++) {
+        auto& count = counts[b];
+        if (items.empty() || count[(items[0].key >> (b * 8)) & 0xFF] == items.size())
+            continue;
+
+        uint32_t offset = 0;
+        for (auto& c : count) {
+            const uint32_t n = c;
+            c = offset;
+            offset += n;
+        }
+        for (const auto& item : items)
+            scratch[count[(item.key >> (b * 8)) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
+
+void RenderQueue::apply(State& state, const Packet& p, StateChanges& changes, bool issue) const
+{
+    const Pipeline& pipeline = pipelines[p.pipeline];
+    if (state.pipeline != p.pipeline) {
+        if (issue) {
+            pipeline.shader->use();
+            pipeline.shader->set(pipeline.u_base_color_texture, 0);
+            pipeline.shader->set(pipeline.u_metallic_roughness_texture, 1);
+        }
+        state.pipeline = p.pipeline;
+        // u_Material is per program
+        state.material = UINT32_MAX;
+        changes.programs++;
+    }
+
+    if (state.VAO != p.VAO) {
+        if (issue)
+            glBindVertexArray(p.VAO);
+        state.VAO = p.VAO;
+        changes.vaos++;
+    }
+
+    // unused slots keep whatever is bound, the material's flags tell the shader not to sample them
+    const int32_t textures[2] = {p.base_color_texture_idx, p.metallic_roughness_texture_idx};
+    for (int unit = 0; unit < 2; unit++) {
+        if (textures[unit] == -1 || textures[unit] == state.textures[unit])
+            continue;
+        if (issue) {
+            const uint32_t id = AssetManager::textures[textures[unit]].acquire();
+            // white keeps the metallic/roughness factors unchanged
+            const glm::vec4 placeholder = unit == 0 ? p.base_color : glm::vec4(1.0f);
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D, id != 0 ? id : AssetManager::placeholder_texture(placeholder));
+        }
+        state.textures[unit] = textures[unit];
+        changes.textures++;
+    }
+
+    if (state.material != p.material) {
+        if (issue)
+            pipeline.shader->set(pipeline.u_material, p.material);
+        state.material = p.material;
+        changes.materials++;
+    }
+
+    const bool cull = !p.double_sided;
+    if (state.cull != cull) {
+        if (issue)
+            cull ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+        state.cull = cull;
+        changes.cull++;
+    }
+
+    // blended surfaces are depth tested against the opaque ones but do not occlude each other
+    const bool blend = p.pass == Pass::TRANSPARENT;
+    if (state.blend != blend) {
+        if (issue) {
+            if (blend) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glDepthMask(GL_FALSE);
+            } else {
+                glDisable(GL_BLEND);
+                glDepthMask(GL_TRUE);
+            }
+        }
+        state.blend = blend;
+        changes.blend++;
+    }
+}
+
+void RenderQueue::submit()
+{
+    instance_buffer.upload(instance_data.data(), instance_data.size() * sizeof(glm::mat4));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, AssetManager::INSTANCE_BINDING, instance_buffer.id());
+
+    State state{};
+    for (const auto& item : items) {
+        const Packet& p = packets[item.packet];
+        apply(state, p, frame_stats.sorted, true);
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, p.count, p.index_type,
+                                                      (void*)(uint64_t{p.offset} * AssetManager::index_size(p.index_type)),
+                                                      p.instance_count, p.base_vertex, p.first_instance);
+    }
+
+    if (!state.cull)
+        glEnable(GL_CULL_FACE);
+    if (state.blend) {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+    glBindVertexArray(0);
+}
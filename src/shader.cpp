@@ -1,8 +1,23 @@
 #include "shader.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
+namespace {
+
+    // Uniform types set with glUniform1i: ints, bools and the sampler types the shaders use.
+    // Add a sampler or image type here once a shader declares one.
+    constexpr GLenum INT_SET_TYPES[] = {GL_INT, GL_BOOL, GL_SAMPLER_2D};
+
+    bool set_as_int(GLenum type)
+    {
+        return std::find(std::begin(INT_SET_TYPES), std::end(INT_SET_TYPES), type) != std::end(INT_SET_TYPES);
+    }
+
+} // end anonymous namespace
+
 Shader::~Shader()
 {
     glDeleteProgram(ID);
@@ -48,42 +63,173 @@ void Shader::check_compile_error(const GLuint shader, const std::string &&type)
     }
 }
 
+void Shader::reflect_uniforms()
+{
+    uniform_location_cache.clear();
+    hashed_locations.clear();
+    location_types.clear();
+
+    GLint nof_uniforms = 0, max_length = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &nof_uniforms);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<GLchar> buffer(std::max(max_length, 1));
+
+    GLint max_location = -1;
+    const auto add = [&](const std::string& name, GLenum type) {
+        const GLint loc = glGetUniformLocation(ID, name.c_str());
+        if (loc < 0)
+            return; // member of a uniform block
+        uniform_location_cache[name] = loc;
+        hashed_locations[uniform_hash(name)] = loc;
+        location_types[loc] = type;
+        max_location = std::max(max_location, loc);
+    };
+
+    for (GLint i = 0; i < nof_uniforms; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // arrays are reported as "name[0]", register every element and the bare name
+        if (name.size() > 3 && name.ends_with("[0]")) {
+            const std::string base = name.substr(0, name.size() - 3);
+            add(base, type);
+            for (GLint e = 0; e < size; e++)
+                add(base + "[" + std::to_string(e) + "]", type);
+        } else {
+            add(name, type);
+        }
+    }
+
+    shadow.assign(max_location + 1, ShadowValue{});
+    stats = UniformStats{};
+}
+
+GLint Shader::checked_location(UniformName name, GLenum type) const
+{
+    const auto it = hashed_locations.find(name.hash);
+    if (it == hashed_locations.end()) {
+        std::cerr << "Uniform '" << name.name << "' is not active." << std::endl;
+        return -1;
+    }
+
+    const GLenum actual = location_types.at(it->second);
+    const bool int_like = type == GL_INT && set_as_int(actual);
+    if (actual != type && !int_like) {
+        std::cerr << "Uniform '" << name.name << "' has a different type than requested." << std::endl;
+        return -1;
+    }
+    return it->second;
+}
+
+GLint Shader::location(const std::string& name) const
+{
+    if (const auto it = uniform_location_cache.find(name); it != uniform_location_cache.end())
+        return it->second;
+    // not reflected (inactive): remember the miss as well
+    const GLint loc = glGetUniformLocation(ID, name.c_str());
+    uniform_location_cache.emplace(name, loc);
+    return loc;
+}
+
+bool Shader::changed(GLint location, const void* value, size_t size) const
+{
+    if (location < 0)
+        return false;
+    if (static_cast<size_t>(location) >= shadow.size())
+        shadow.resize(location + 1);
+
+    auto& s = shadow[location];
+    if (s.valid && std::memcmp(s.bytes, value, size) == 0) {
+        stats.elided++;
+        return false;
+    }
+    std::memcpy(s.bytes, value, size);
+    s.valid = true;
+    stats.updates++;
+    return true;
+}
+
+void Shader::write(GLint location, int value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform1i(ID, location, value);
+}
+
+void Shader::write(GLint location, uint32_t value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform1ui(ID, location, value);
+}
+
+void Shader::write(GLint location, float value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform1f(ID, location, value);
+}
+
+void Shader::write(GLint location, const glm::vec2& value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform2fv(ID, location, 1, &value[0]);
+}
+
+void Shader::write(GLint location, const glm::vec3& value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform3fv(ID, location, 1, &value[0]);
+}
+
+void Shader::write(GLint location, const glm::vec4& value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniform4fv(ID, location, 1, &value[0]);
+}
+
+void Shader::write(GLint location, const glm::mat4& value) const
+{
+    if (changed(location, &value, sizeof(value)))
+        glProgramUniformMatrix4fv(ID, location, 1, GL_FALSE, &value[0][0]);
+}
+
 void Shader::set_bool(const std::string &name, bool value) const
 {
-    glProgramUniform1i(ID, glGetUniformLocation(ID, name.c_str()), (int)value);
+    write(location(name), static_cast<int>(value));
 }
 
 void Shader::set_int(const std::string &name, int value) const
 {
-    glProgramUniform1i(ID, glGetUniformLocation(ID, name.c_str()), value);
+    write(location(name), value);
 }
 
 void Shader::set_uint(const std::string &name, uint value) const
 {
-    glProgramUniform1ui(ID, glGetUniformLocation(ID, name.c_str()), value);
+    write(location(name), static_cast<uint32_t>(value));
 }
 
 void Shader::set_float(const std::string &name, float value) const
 {
-    glProgramUniform1f(ID, glGetUniformLocation(ID, name.c_str()), value);
+    write(location(name), value);
 }
 
 void Shader::set_vec2(const std::string &name, const glm::vec2 &value) const
 {
-    glProgramUniform2fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    write(location(name), value);
 }
 
 void Shader::set_vec3(const std::string &name, const glm::vec3 &value) const
 {
-    glProgramUniform3fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    write(location(name), value);
 }
 
 void Shader::set_vec4(const std::string &name, const glm::vec4 &value) const
 {
-    glProgramUniform4fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    write(location(name), value);
 }
 
 void Shader::set_mat4(const std::string &name, const glm::mat4 &value) const
 {
-    glProgramUniformMatrix4fv(ID, glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &value[0][0]);
+    write(location(name), value);
 }
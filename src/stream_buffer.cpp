@@ -0,0 +1,26 @@
+#include "stream_buffer.hpp"
+
+#include <algorithm>
+
+StreamBuffer::StreamBuffer(GLenum target)
+    : target(target)
+{
+    glGenBuffers(1, &ID);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    glDeleteBuffers(1, &ID);
+}
+
+void StreamBuffer::upload(const void* data, size_t size)
+{
+    if (size == 0)
+        return;
+    glBindBuffer(target, ID);
+    if (size > capacity) {
+        capacity = std::max(size, capacity * 2);
+        glBufferData(target, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(target, 0, size, data);
+}
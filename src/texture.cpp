@@ -1,6 +1,9 @@
 #include "texture.hpp"
+#include "job_system.hpp"
+#include "stb_image.h"
 
 #include <cstdio>
+#include <cstring>
 #include <assert.h>
 
 /*s
@@ -141,3 +144,92 @@ bool Texture::create_texture(const TextureConfig &conf, const unsigned char* dat
 
     return true;
 }
+
+void Texture::create_lazy(const TextureConfig &conf, std::span<const unsigned char> compressed)
+{
+    pending = std::make_shared<PendingImage>();
+    pending->conf = conf;
+    pending->compressed.assign(compressed.begin(), compressed.end());
+}
+
+// Fills in the pixel format and size of 'conf'.
+static bool decode_compressed(std::span<const unsigned char> compressed, Texture::TextureConfig& conf,
+                              std::vector<unsigned char>& pixels)
+{
+    const auto* bytes = compressed.data();
+    const int size = static_cast<int>(compressed.size());
+
+    // same conversion tinygltf applies: keep 16-bit images, expand everything to RGBA
+    int w = 0, h = 0, comp = 0;
+    int bits = 8;
+    void* data = nullptr;
+    if (stbi_is_16_bit_from_memory(bytes, size)) {
+        data = stbi_load_16_from_memory(bytes, size, &w, &h, &comp, 4);
+        bits = 16;
+    }
+    if (data == nullptr) {
+        data = stbi_load_from_memory(bytes, size, &w, &h, &comp, 4);
+        bits = 8;
+    }
+    if (data == nullptr)
+        return false;
+
+    const size_t nof_bytes = static_cast<size_t>(w) * h * 4 * (bits / 8);
+    pixels.resize(nof_bytes);
+    std::memcpy(pixels.data(), data, nof_bytes);
+    stbi_image_free(data);
+
+    conf.internalformat = 4;
+    conf.format = bits;
+    conf.type = bits == 16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    conf.width = w;
+    conf.height = h;
+    return true;
+}
+
+bool Texture::create_decoded(const TextureConfig &conf, std::span<const unsigned char> compressed)
+{
+    TextureConfig decoded = conf;
+    std::vector<unsigned char> pixels{};
+    if (!decode_compressed(compressed, decoded, pixels))
+        return false;
+    return create_texture(decoded, pixels.data());
+}
+
+static void decode_pending(Texture::PendingImage& img)
+{
+    if (!decode_compressed(img.compressed, img.conf, img.pixels)) {
+        img.state.store(Texture::PendingImage::State::FAILED, std::memory_order_release);
+        return;
+    }
+    img.compressed.clear();
+    img.compressed.shrink_to_fit();
+    img.state.store(Texture::PendingImage::State::DECODED, std::memory_order_release);
+}
+
+uint32_t Texture::acquire()
+{
+    if (ID != 0 || !pending)
+        return ID;
+
+    using State = PendingImage::State;
+    switch (pending->state.load(std::memory_order_acquire)) {
+        case State::COMPRESSED:
+            pending->state.store(State::DECODING, std::memory_order_relaxed);
+            job_system().submit([img = pending] { decode_pending(*img); });
+            break;
+        case State::DECODED:
+            if (!create_texture(pending->conf, pending->pixels.data()))
+                printf("Failed to upload lazy texture.\n");
+            pending.reset();
+            break;
+        case State::FAILED:
+            printf("Failed to decode lazy texture, it will stay on its placeholder.\n");
+            pending.reset();
+            break;
+        case State::DECODING:
+            break;
+    }
+
+    return ID;
+}
@@ -0,0 +1,229 @@
+#include "transform.hpp"
+#include "job_system.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    void compose_trs_scalar(const glm::mat4& parent, const glm::vec3* t, const glm::vec4* r, const glm::vec3* s,
+                            size_t begin, size_t end, glm::mat4* out)
+    {
+        for (size_t i = begin; i < end; i++) {
+            const float x = r[i].x, y = r[i].y, z = r[i].z, w = r[i].w;
+            glm::mat4 local{1.0f};
+            local[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * s[i].x;
+            local[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * s[i].y;
+            local[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * s[i].z;
+            local[3] = glm::vec4(t[i], 1.0f);
+            out[i] = parent * local;
+        }
+    }
+
+#ifdef TRANSFORM_X86
+    // Returns the first index it did not handle.
+    size_t compose_trs_sse(const glm::mat4& parent, const glm::vec3* t, const glm::vec4* r, const glm::vec3* s,
+                           size_t count, glm::mat4* out)
+    {
+        const auto p = [&](int col, int row) { return _mm_set1_ps(parent[col][row]); };
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // four quaternions -> x, y, z, w with one instance per lane
+            __m128 x = _mm_loadu_ps(&r[i + 0].x);
+            __m128 y = _mm_loadu_ps(&r[i + 1].x);
+            __m128 z = _mm_loadu_ps(&r[i + 2].x);
+            __m128 w = _mm_loadu_ps(&r[i + 3].x);
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            // vec3s are 12 bytes, a 16-byte load of the last one could run past the array
+            const __m128 tx = _mm_setr_ps(t[i].x, t[i + 1].x, t[i + 2].x, t[i + 3].x);
+            const __m128 ty = _mm_setr_ps(t[i].y, t[i + 1].y, t[i + 2].y, t[i + 3].y);
+            const __m128 tz = _mm_setr_ps(t[i].z, t[i + 1].z, t[i + 2].z, t[i + 3].z);
+            const __m128 sx = _mm_setr_ps(s[i].x, s[i + 1].x, s[i + 2].x, s[i + 3].x);
+            const __m128 sy = _mm_setr_ps(s[i].y, s[i + 1].y, s[i + 2].y, s[i + 3].y);
+            const __m128 sz = _mm_setr_ps(s[i].z, s[i + 1].z, s[i + 2].z, s[i + 3].z);
+
+            const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+            const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+            const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+            // local[col][row] of R * S, translation is the fourth column
+            __m128 local[3][3];
+            local[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+            local[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+            local[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+            local[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+            local[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+            local[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+            local[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+            local[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+            local[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+            for (int col = 0; col < 4; col++) {
+                __m128 rows[4];
+                for (int row = 0; row < 4; row++) {
+                    if (col < 3) {
+                        rows[row] = _mm_mul_ps(p(0, row), local[col][0]);
+                        rows[row] = _mm_add_ps(rows[row], _mm_mul_ps(p(1, row), local[col][1]));
+                        rows[row] = _mm_add_ps(rows[row], _mm_mul_ps(p(2, row), local[col][2]));
+                    } else {
+                        rows[row] = _mm_add_ps(_mm_mul_ps(p(0, row), tx), p(3, row));
+                        rows[row] = _mm_add_ps(rows[row], _mm_mul_ps(p(1, row), ty));
+                        rows[row] = _mm_add_ps(rows[row], _mm_mul_ps(p(2, row), tz));
+                    }
+                }
+                // lanes are instances, transpose back to one column per instance
+                _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+                for (int k = 0; k < 4; k++)
+                    _mm_storeu_ps(&out[i + k][col].x, rows[k]);
+            }
+        }
+        return i;
+    }
+#endif
+
+} // end anonymous namespace
+
+void compose_trs(const glm::mat4& parent, const glm::vec3* translations, const glm::vec4* rotations,
+                 const glm::vec3* scales, size_t count, glm::mat4* out)
+{
+    size_t begin = 0;
+#ifdef TRANSFORM_X86
+    begin = compose_trs_sse(parent, translations, rotations, scales, count, out);
+#endif
+    compose_trs_scalar(parent, translations, rotations, scales, begin, count, out);
+}
+
+uint32_t TransformHierarchy::add(int32_t parent_idx, const glm::vec3& t, const glm::vec4& r, const glm::vec3& s)
+{
+    glm::mat4 m;
+    compose_trs(glm::mat4(1.0f), &t, &r, &s, 1, &m);
+    const uint32_t node = add(parent_idx, m);
+    translation[node] = t;
+    rotation[node] = r;
+    scale[node] = s;
+    return node;
+}
+
+uint32_t TransformHierarchy::add(int32_t parent_idx, const glm::mat4& local_matrix)
+{
+    parent.push_back(parent_idx);
+    subtree_end.push_back(0);
+    translation.emplace_back(0.0f);
+    rotation.emplace_back(0.0f, 0.0f, 0.0f, 1.0f);
+    scale.emplace_back(1.0f);
+    local.push_back(local_matrix);
+    world.push_back(local_matrix);
+    dirty.push_back(1);
+    changed.push_back(0);
+    return static_cast<uint32_t>(parent.size() - 1);
+}
+
+void TransformHierarchy::finalize()
+{
+    // in pre-order a subtree ends where its last descendant's subtree ends
+    for (uint32_t i = 0; i < size(); i++)
+        subtree_end[i] = i + 1;
+    for (uint32_t i = static_cast<uint32_t>(size()); i-- > 0;) {
+        if (parent[i] != NO_PARENT)
+            subtree_end[parent[i]] = std::max(subtree_end[parent[i]], subtree_end[i]);
+    }
+    std::fill(dirty.begin(), dirty.end(), 1);
+    any_dirty = size() > 0;
+}
+
+void TransformHierarchy::set_trs(uint32_t node, const glm::vec3& t, const glm::vec4& r, const glm::vec3& s)
+{
+    translation[node] = t;
+    rotation[node] = r;
+    scale[node] = s;
+    compose_trs(glm::mat4(1.0f), &t, &r, &s, 1, &local[node]);
+    dirty[node] = 1;
+    any_dirty = true;
+}
+
+void TransformHierarchy::set_local(uint32_t node, const glm::mat4& local_matrix)
+{
+    local[node] = local_matrix;
+    dirty[node] = 1;
+    any_dirty = true;
+}
+
+void TransformHierarchy::refresh(uint32_t node)
+{
+    world[node] = parent[node] == NO_PARENT ? local[node] : world[parent[node]] * local[node];
+    dirty[node] = 0;
+    changed[node] = 1;
+}
+
+// Breaks 'range' into subtrees of at most 'grain' nodes for update(). The root of every subtree
+// that is split goes to 'heads', which are refreshed first and in order, so each part only
+// depends on nodes that are already up to date.
+void TransformHierarchy::split(Range range, uint32_t grain)
+{
+    // explicit stack, a long chain of nodes would be as deep a recursion. A head is always
+    // popped before its children are pushed, so every head comes after its parent's in 'heads'.
+    // Siblings come out in reverse, which is fine as they do not depend on each other.
+    std::vector<Range> pending{range};
+    while (!pending.empty()) {
+        const Range r = pending.back();
+        pending.pop_back();
+        if (r.end - r.begin <= grain) {
+            work.push_back(r);
+            continue;
+        }
+        heads.push_back(r.begin);
+        for (uint32_t child = r.begin + 1; child < r.end; child = subtree_end[child])
+            pending.push_back(Range{child, subtree_end[child]});
+    }
+}
+
+uint32_t TransformHierarchy::update()
+{
+    for (const auto& r : updated)
+        std::fill(changed.begin() + r.begin, changed.begin() + r.end, 0);
+    updated.clear();
+    if (!any_dirty)
+        return 0;
+    any_dirty = false;
+
+    // every dirty node not inside an earlier dirty subtree starts one
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < size();) {
+        if (!dirty[i]) {
+            i++;
+            continue;
+        }
+        updated.push_back(Range{i, subtree_end[i]});
+        total += subtree_end[i] - i;
+        i = subtree_end[i];
+    }
+
+    if (total < PARALLEL_TRANSFORM_THRESHOLD) {
+        for (const auto& r : updated) {
+            for (uint32_t i = r.begin; i < r.end; i++)
+                refresh(i);
+        }
+        return total;
+    }
+
+    // a few parts per worker so a deep subtree does not leave the others idle
+    const uint32_t grain = std::max<uint32_t>(1024, total / static_cast<uint32_t>(4 * (job_system().size() + 1)));
+    work.clear();
+    heads.clear();
+    for (const auto& r : updated)
+        split(r, grain);
+    for (const uint32_t node : heads)
+        refresh(node);
+    job_system().parallel_for(work.size(), [&](size_t w) {
+        for (uint32_t i = work[w].begin; i < work[w].end; i++)
+            refresh(i);
+    });
+    return total;
+}